@@ -0,0 +1,98 @@
+#include "camerapath.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+CameraPath::CameraPath()
+{
+}
+
+/*=================================================================================================
+  KEYS
+=================================================================================================*/
+
+bool CameraPath::Load( const std::string& path )
+{
+	std::ifstream file( path );
+	if( file.is_open() == false )
+	{
+		std::cerr << "could not open camera path " << path << std::endl;
+		return false;
+	}
+
+	Clear();
+
+	std::string line;
+	for( int lineNumber = 1; std::getline( file, line ); lineNumber++ )
+	{
+		size_t comment = line.find( '#' );
+		if( comment != std::string::npos )
+			line.erase( comment );
+
+		std::istringstream fields( line );
+		CameraKey key;
+		if( !( fields >> key.Time ) )
+			continue; // blank or comment-only line
+
+		if( !( fields >> key.RotationX >> key.RotationY >> key.Zoom ) )
+		{
+			std::cerr << path << ":" << lineNumber << ": expected \"time rotationX rotationY zoom\"" << std::endl;
+			Clear();
+			return false;
+		}
+
+		AddKey( key.Time, key.RotationX, key.RotationY, key.Zoom );
+	}
+
+	return Keys.empty() == false;
+}
+
+void CameraPath::AddKey( float time, float rotationX, float rotationY, float zoom )
+{
+	CameraKey key = { time, rotationX, rotationY, zoom };
+
+	// Keep the keys sorted; a key at an existing time goes after it
+	std::vector<CameraKey>::iterator position = std::upper_bound( Keys.begin(), Keys.end(), key,
+		[]( const CameraKey& a, const CameraKey& b ) { return a.Time < b.Time; } );
+	Keys.insert( position, key );
+}
+
+void CameraPath::Clear( void )
+{
+	Keys.clear();
+}
+
+/*=================================================================================================
+  EVALUATION
+=================================================================================================*/
+
+CameraKey CameraPath::Evaluate( float time ) const
+{
+	if( Keys.empty() == true )
+		return { time, 0.0f, 0.0f, 1.0f };
+
+	if( time <= Keys.front().Time )
+		return Keys.front();
+	if( time >= Keys.back().Time )
+		return Keys.back();
+
+	// First key after time; the one before it starts the segment
+	std::vector<CameraKey>::const_iterator next = std::upper_bound( Keys.begin(), Keys.end(), time,
+		[]( float t, const CameraKey& key ) { return t < key.Time; } );
+	const CameraKey& a = *( next - 1 );
+	const CameraKey& b = *next;
+
+	float s = ( time - a.Time ) / ( b.Time - a.Time );
+
+	CameraKey key;
+	key.Time = time;
+	key.RotationX = a.RotationX + ( b.RotationX - a.RotationX ) * s;
+	key.RotationY = a.RotationY + ( b.RotationY - a.RotationY ) * s;
+	key.Zoom = a.Zoom + ( b.Zoom - a.Zoom ) * s;
+	return key;
+}
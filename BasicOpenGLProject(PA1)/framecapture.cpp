@@ -0,0 +1,183 @@
+#include "framecapture.h"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+FrameCapture::FrameCapture()
+{
+	FBO = 0;
+	ColorRenderbuffer = 0;
+	DepthRenderbuffer = 0;
+	PixelBuffers[0] = PixelBuffers[1] = 0;
+	Next = 0;
+	Width = 0;
+	Height = 0;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+FrameCapture::~FrameCapture()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+bool FrameCapture::Create( GLsizei width, GLsizei height )
+{
+	if( FBO != 0 )
+		return true;
+
+	Width = width;
+	Height = height;
+
+	glGenRenderbuffers( 1, &ColorRenderbuffer );
+	glBindRenderbuffer( GL_RENDERBUFFER, ColorRenderbuffer );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, Width, Height );
+
+	glGenRenderbuffers( 1, &DepthRenderbuffer );
+	glBindRenderbuffer( GL_RENDERBUFFER, DepthRenderbuffer );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height );
+	glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+	glGenFramebuffers( 1, &FBO );
+	glBindFramebuffer( GL_FRAMEBUFFER, FBO );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorRenderbuffer );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthRenderbuffer );
+
+	GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	glGenBuffers( 2, PixelBuffers );
+	for( int i = 0; i < 2; i++ )
+	{
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, PixelBuffers[i] );
+		glBufferData( GL_PIXEL_PACK_BUFFER, (GLsizeiptr)Width * Height * 4, NULL, GL_STREAM_READ );
+		PendingPaths[i].clear();
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	Next = 0;
+
+	if( status != GL_FRAMEBUFFER_COMPLETE )
+	{
+		std::cerr << "offscreen framebuffer incomplete (status 0x" << std::hex << status << std::dec << ")" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void FrameCapture::Delete( void )
+{
+	if( FBO == 0 )
+		return;
+
+	glDeleteBuffers( 2, PixelBuffers );
+	glDeleteFramebuffers( 1, &FBO );
+	glDeleteRenderbuffers( 1, &ColorRenderbuffer );
+	glDeleteRenderbuffers( 1, &DepthRenderbuffer );
+
+	FBO = 0;
+	ColorRenderbuffer = DepthRenderbuffer = 0;
+	PixelBuffers[0] = PixelBuffers[1] = 0;
+	PendingPaths[0].clear();
+	PendingPaths[1].clear();
+}
+
+void FrameCapture::Bind( void ) const
+{
+	glBindFramebuffer( GL_FRAMEBUFFER, FBO );
+	glViewport( 0, 0, Width, Height );
+}
+
+void FrameCapture::Unbind( void ) const
+{
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+/*=================================================================================================
+  CAPTURE
+=================================================================================================*/
+
+void FrameCapture::Capture( const std::string& path )
+{
+	// Queue this frame; with a pack buffer bound glReadPixels returns without waiting for the GPU
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, FBO );
+	glReadBuffer( GL_COLOR_ATTACHMENT0 );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, PixelBuffers[Next] );
+	glReadPixels( 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0 );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	PendingPaths[Next] = path;
+
+	// The other buffer holds the previous frame, which has had a whole frame's time to arrive
+	Next = 1 - Next;
+	writePending( Next );
+}
+
+void FrameCapture::Finish( void )
+{
+	// Oldest first, so files are written in frame order
+	writePending( Next );
+	writePending( 1 - Next );
+}
+
+void FrameCapture::writePending( int index )
+{
+	if( PendingPaths[index].empty() == true )
+		return;
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, PixelBuffers[index] );
+
+	const unsigned char* pixels = (const unsigned char*)glMapBuffer( GL_PIXEL_PACK_BUFFER, GL_READ_ONLY );
+	if( pixels != NULL )
+	{
+		if( WritePPM( PendingPaths[index], pixels, Width, Height ) == false )
+			std::cerr << "could not write frame " << PendingPaths[index] << std::endl;
+
+		glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	PendingPaths[index].clear();
+}
+
+/*=================================================================================================
+  PPM
+=================================================================================================*/
+
+bool FrameCapture::WritePPM( const std::string& path, const unsigned char* pixels, GLsizei width, GLsizei height )
+{
+	FILE* file = fopen( path.c_str(), "wb" );
+	if( file == NULL )
+		return false;
+
+	fprintf( file, "P6\n%d %d\n255\n", width, height );
+
+	// PPM rows run top to bottom, GL rows bottom to top; alpha is dropped
+	std::vector<unsigned char> row( (size_t)width * 3 );
+	for( GLsizei y = height - 1; y >= 0; y-- )
+	{
+		const unsigned char* src = pixels + (size_t)y * width * 4;
+		for( GLsizei x = 0; x < width; x++ )
+		{
+			row[x * 3 + 0] = src[x * 4 + 0];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + 2];
+		}
+		fwrite( row.data(), 1, row.size(), file );
+	}
+
+	bool ok = ferror( file ) == 0;
+	fclose( file );
+	return ok;
+}
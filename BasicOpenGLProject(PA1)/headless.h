@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include "camerapath.h"
+
+/**
+Runs a viewer without a window: the scene is rendered into a FrameCapture along a CameraPath and every
+frame is written to disk. On Linux the context comes from an EGL pbuffer (link with -lEGL), which Mesa's
+llvmpipe provides with no GPU and no display server; elsewhere, or if EGL fails, a hidden freeglut window is used.
+**/
+class HeadlessMode
+{
+public:
+	HeadlessMode();
+	~HeadlessMode();
+
+public:
+	/**
+	Reads the headless options and leaves every other argument alone:
+	  --headless            render offscreen instead of opening a window
+	  --frames N            number of frames to render (default 120). A camera path is sampled from its
+	                        first key to its last inclusive; frame k of the default turn is at
+	                        360 * k / N degrees, so the turn is evenly spaced and loops without a repeat
+	  --camera-path FILE    camera keys, see CameraPath (default: one turn around the Y axis)
+	  --output DIRECTORY    where frame_NNNN.ppm files go (default: the working directory)
+	  --size WIDTHxHEIGHT   frame size (default 800x800)
+	*@return Whether --headless was given.
+	**/
+	bool ParseArguments( int argc, char** argv );
+
+	/**
+	Creates a context with no visible window, makes it current and initializes GLEW.
+	**/
+	bool CreateContext( int& argc, char** argv );
+
+	/**
+	Renders and writes every frame, then prints how long it took.
+	*@param applyCamera Moves the viewer's camera to a key of the path.
+	*@param render Draws the scene into the bound framebuffer, without swapping.
+	*@return EXIT_SUCCESS, or EXIT_FAILURE if the framebuffer or camera path couldn't be set up.
+	**/
+	int Run( void ( *applyCamera )( const CameraKey& key ), void ( *render )() );
+
+public:
+	bool IsEnabled() const { return Enabled; }
+	int GetWidth() const { return Width; }
+	int GetHeight() const { return Height; }
+
+private:
+	bool createEGLContext();
+	void destroyEGLContext();
+
+	HeadlessMode( const HeadlessMode& ) = delete;
+	HeadlessMode& operator=( const HeadlessMode& ) = delete;
+
+private:
+	bool Enabled;
+	int Frames;
+	int Width, Height;
+	std::string CameraPathFile;
+	std::string OutputDirectory;
+
+	// EGL handles, kept opaque so EGL headers stay out of the viewers
+	void* Display;
+	void* Surface;
+	void* Context;
+};
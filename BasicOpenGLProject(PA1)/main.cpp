@@ -5,8 +5,13 @@
 #include <random>
 
 #include <iostream>
+#include <cstring>
 #include "shader.h"
 #include "shaderprogram.h"
+#include "meshbuffer.h"
+#include "uniformbuffer.h"
+#include "headless.h"
+#include "profiler.h"
 
 /*=================================================================================================
 	DOMAIN
@@ -18,6 +23,11 @@ const int InitWindowHeight = 800;
 int WindowWidth  = InitWindowWidth;
 int WindowHeight = InitWindowHeight;
 
+// Renders a scripted camera path into image files instead of opening a window (--headless).
+// Declared before every GL object: globals are destroyed in reverse order, and this one's
+// destructor tears down the context the others still delete their names in
+HeadlessMode headless;
+
 // Last mouse cursor position
 int LastMousePosX = 0;
 int LastMousePosY = 0;
@@ -48,9 +58,32 @@ glm::mat4 PerspProjectionMatrix( 1.0f );
 glm::mat4 PerspViewMatrix( 1.0f );
 glm::mat4 PerspModelMatrix( 1.0f );
 
+// Mirrors the std140 Camera block in the shaders (mat4 members need no padding)
+struct CameraUniforms
+{
+	glm::mat4 projectionMatrix;
+	glm::mat4 viewMatrix;
+	glm::mat4 modelMatrix;
+};
+
+// Uploaded once per frame and read by every program through the same binding point
+const GLuint CameraBinding = 0;
+UniformBuffer CameraBuffer;
+
 float perspZoom = 1.0f, perspSensitivity = 0.35f;
 float perspRotationX = 0.0f, perspRotationY = 0.0f;
 
+// Set whenever an input changes the camera or model transform; the matrices are only rebuilt then
+bool transforms_dirty = true;
+
+// Draw a new frame on every idle cycle instead of only after a change (--continuous, for benchmarking)
+bool continuous_rendering = false;
+
+// Per-pass CPU and GPU timings, reported every 120 frames (--profile, --profile-csv FILE)
+Profiler profiler;
+bool profiling_enabled = false;
+std::string profiling_csv = "";
+
 /*=================================================================================================
 	OBJECTS
 =================================================================================================*/
@@ -85,8 +118,7 @@ float axis_colors[] = {
 	0.0f, 0.0f, 1.0f, 1.0f
 };
 
-GLuint axis2_VAO;
-GLuint axis2_VBO[2];
+MeshBuffer axis2_Buffer;
 
 float axis2_vertices[] = {
 
@@ -264,15 +296,29 @@ void CreateTransformationMatrices( void )
 
 	PerspViewMatrix = glm::lookAt( eye, center, up );
 
+	if( flipCamera == true )
+	{
+		// Flip the camera view by multiplying the view matrix with a scaling matrix
+		PerspViewMatrix = glm::scale( PerspViewMatrix, glm::vec3( -1.0f, -1.0f, 1.0f ) );
+	}
+
 	// MODEL MATRIX
 	PerspModelMatrix = glm::mat4( 1.0 );
 	PerspModelMatrix = glm::rotate( PerspModelMatrix, glm::radians( perspRotationX ), glm::vec3( 1.0, 0.0, 0.0 ) );
 	PerspModelMatrix = glm::rotate( PerspModelMatrix, glm::radians( perspRotationY ), glm::vec3( 0.0, 1.0, 0.0 ) );
 	PerspModelMatrix = glm::scale( PerspModelMatrix, glm::vec3( perspZoom ) );
+
+	// Upload once; every program with a Camera block reads it from the binding point
+	CameraUniforms camera = { PerspProjectionMatrix, PerspViewMatrix, PerspModelMatrix };
+	CameraBuffer.Create( CameraBinding, sizeof( camera ) );
+	CameraBuffer.SetData( &camera );
 }
 
 void CreateShaders( void )
 {
+	// Submit every program first, then collect all compile/link results together
+	ShaderProgram::BeginBatch();
+
 	// Renders without any transformations
 	PassthroughShader.Create( "./shaders/simple.vert", "./shaders/simple.frag" );
 
@@ -282,6 +328,12 @@ void CreateShaders( void )
 	//
 	// Additional shaders would be defined here
 	//
+
+	ShaderProgram::EndBatch();
+
+	// The camera matrices come from the shared uniform buffer instead of per-program uniforms
+	PassthroughShader.SetUniformBlockBinding( "Camera", CameraBinding );
+	PerspectiveShader.SetUniformBlockBinding( "Camera", CameraBinding );
 }
 
 /*=================================================================================================
@@ -318,24 +370,16 @@ void CreateAxisBuffers( void )
 //
 void CreateMyOwnObject(void) //Copy of create Axis Buffers for my new object
 {
-	glGenVertexArrays(1, &axis2_VAO); //generate 1 new VAO, its ID is returned in axis2_VAO
-	glBindVertexArray(axis2_VAO); //bind the new VAO so the subsequent commands modify it
-
-	glGenBuffers(2, &axis2_VBO[0]); //generate 2 buffers for data, their IDs are returned to the axis2_VBO array
-
-	// first buffer: vertex coordinates
-	glBindBuffer(GL_ARRAY_BUFFER, axis2_VBO[0]); //bind the first buffer using its ID
-	glBufferData(GL_ARRAY_BUFFER, sizeof(axis2_vertices), axis2_vertices, GL_STATIC_DRAW); //send coordinate array to the GPU
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0); //let GPU know this is attribute 0, made up of 4 floats
-	glEnableVertexAttribArray(0);
-
-	// second buffer: colors
-	glBindBuffer(GL_ARRAY_BUFFER, axis2_VBO[1]); //bind the second buffer using its ID
-	glBufferData(GL_ARRAY_BUFFER, sizeof(axis2_colors), axis2_colors, GL_STATIC_DRAW); //send color array to the GPU
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0); //let GPU know this is attribute 1, made up of 4 floats
-	glEnableVertexAttribArray(1);
+	// the VAO and its 2 buffers are only generated the first time, afterwards they are refilled in place
+	if (axis2_Buffer.IsCreated() == false)
+	{
+		axis2_Buffer.Create(2);
+		axis2_Buffer.SetAttribute(0, 0, 4); //first buffer: vertex coordinates, attribute 0 made up of 4 floats
+		axis2_Buffer.SetAttribute(1, 1, 4); //second buffer: colors, attribute 1 made up of 4 floats
+	}
 
-	glBindVertexArray(0); //unbind when done
+	axis2_Buffer.SetData(0, axis2_vertices, sizeof(axis2_vertices)); //send coordinate array to the GPU
+	axis2_Buffer.SetData(1, axis2_colors, sizeof(axis2_colors)); //send color array to the GPU
 }
 	//NOTE: You will probably not use an arra
 //
@@ -351,9 +395,16 @@ void CreateMyOwnObject(void) //Copy of create Axis Buffers for my new object
 //-----------------------------------------------------------------------------
 
 
+// Rebuilds the matrices and draws one new frame once the pending events are handled
+void invalidate_transforms( void )
+{
+	transforms_dirty = true;
+	glutPostRedisplay();
+}
+
+// Only registered in continuous mode; otherwise frames are drawn on demand
 void idle_func()
 {
-	//uncomment below to repeatedly draw new frames
 	glutPostRedisplay();
 }
 
@@ -363,7 +414,7 @@ void reshape_func( int width, int height )
 	WindowHeight = height;
 
 	glViewport( 0, 0, width, height );
-	glutPostRedisplay();
+	invalidate_transforms();
 }
 
 void keyboard_func( unsigned char key, int x, int y )
@@ -396,6 +447,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		{
 			// Toggle the flipObjects variable
 			flipCamera = !flipCamera;
+			transforms_dirty = true;
 			std::cout << "Flip objects: " << (flipCamera ? "On" : "Off") << std::endl;
 			break;
 		}
@@ -413,7 +465,13 @@ void keyboard_func( unsigned char key, int x, int y )
 			glutAttachMenu(GLUT_MIDDLE_BUTTON);
 			break;
 		}
+
+		// Keys without a binding change nothing on screen
+		default:
+			return;
 	}
+
+	glutPostRedisplay();
 }
 
 void key_released( unsigned char key, int x, int y )
@@ -448,11 +506,16 @@ void mouse_func( int button, int state, int x, int y )
 	if( button == 3 )
 	{
 		perspZoom += 0.03f;
+		invalidate_transforms();
 	}
 	else if( button == 4 )
 	{
+		// At the zoom floor nothing changes, so nothing is redrawn
 		if( perspZoom - 0.03f > 0.0f )
+		{
 			perspZoom -= 0.03f;
+			invalidate_transforms();
+		}
 	}
 
 	mouse_states[ button ] = ( state == GLUT_DOWN );
@@ -485,6 +548,7 @@ void active_motion_func( int x, int y )
 	{
 		perspRotationY += ( x - LastMousePosX ) * perspSensitivity;
 		perspRotationX += ( y - LastMousePosY ) * perspSensitivity;
+		invalidate_transforms();
 	}
 
 	if (mouse_states[2] == true)
@@ -501,8 +565,7 @@ void active_motion_func( int x, int y )
 		}
 
 		// Update the VBO with the new vertex coordinates
-		glBindBuffer(GL_ARRAY_BUFFER, axis2_VBO[0]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(axis2_vertices), axis2_vertices, GL_STATIC_DRAW);
+		axis2_Buffer.UpdateData(0, 0, axis2_vertices, sizeof(axis2_vertices));
 
 		// Mark the window for redisplay
 		glutPostRedisplay();
@@ -543,8 +606,11 @@ void menu(int value)
 	case 4:
 		std::cout << "You selected 'F' to flip .\n";
 		flipCamera = !flipCamera;
+		transforms_dirty = true;
 		break;
 	}
+
+	glutPostRedisplay();
 }
 
 
@@ -552,29 +618,23 @@ void menu(int value)
 	RENDERING
 =================================================================================================*/
 
-void display_func( void )
+// Draws one frame into the bound framebuffer: the window's back buffer, or the offscreen one when headless
+void render_scene( void )
 {
+	profiler.BeginFrame();
+
 	// Clear the contents of the back buffer
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-	// Update transformation matrices
-	CreateTransformationMatrices();
-
-	// Choose which shader to user, and send the transformation matrix information to it
-	PerspectiveShader.Use();
-	PerspectiveShader.SetUniform( "projectionMatrix", glm::value_ptr( PerspProjectionMatrix ), 4, GL_FALSE, 1 );
-	PerspectiveShader.SetUniform( "viewMatrix", glm::value_ptr( PerspViewMatrix ), 4, GL_FALSE, 1 );
-	PerspectiveShader.SetUniform( "modelMatrix", glm::value_ptr( PerspModelMatrix ), 4, GL_FALSE, 1 );
-
-	glm::mat4 viewMatrix = PerspViewMatrix;
-	if (flipCamera)
+	// Update transformation matrices, only if an input changed them since the last frame
+	if( transforms_dirty == true )
 	{
-		// Flip the camera view by multiplying the view matrix with a scaling matrix
-		viewMatrix = glm::scale(viewMatrix, glm::vec3(-1.0f, -1.0f, 1.0f));
+		CreateTransformationMatrices();
+		transforms_dirty = false;
 	}
 
-	PerspectiveShader.SetUniform("viewMatrix", glm::value_ptr(viewMatrix), 4, GL_FALSE, 1);
-	PerspectiveShader.SetUniform("modelMatrix", glm::value_ptr(PerspModelMatrix), 4, GL_FALSE, 1);
+	// Choose which shader to use; the transformation matrices are already in the camera buffer
+	PerspectiveShader.Use();
 
 
 	// Drawing in wireframe?
@@ -584,22 +644,42 @@ void display_func( void )
 		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 
 	// Bind the axis Vertex Array Object created earlier, and draw it
+	profiler.Begin( "axis" );
 	glBindVertexArray( axis_VAO );
 	glDrawArrays( GL_LINES, 0, 6 ); // 6 = number of vertices in the object
+	profiler.End();
 
 	//
 	// Bind and draw your object here
-	glBindVertexArray( axis2_VAO );
+	profiler.Begin( "object" );
+	axis2_Buffer.Bind();
 	glDrawArrays(GL_TRIANGLES, 0, 1000); // 1000 vertices
+	profiler.End();
 	//
 
 	// Unbind when done
 	glBindVertexArray( 0 );
 
+	profiler.EndFrame();
+}
+
+void display_func( void )
+{
+	render_scene();
+
 	// Swap the front and back buffers
 	glutSwapBuffers();
 }
 
+// Headless mode moves the same orbit camera the mouse does
+void apply_camera_key( const CameraKey& key )
+{
+	perspRotationX = key.RotationX;
+	perspRotationY = key.RotationY;
+	perspZoom = key.Zoom;
+	transforms_dirty = true;
+}
+
 /*=================================================================================================
 	INIT
 =================================================================================================*/
@@ -628,13 +708,20 @@ void init( void )
 	// Call my own function for my object
 	CreateMyOwnObject();
 
-	// Create menu setup
-	menu_id = glutCreateMenu(menu);
-	glutAddMenuEntry("Toggle Wireframe (W)", 1);
-	glutAddMenuEntry("Randomize Colors (R)", 2);
-	glutAddMenuEntry("Exit (ESC)", 3);
-	glutAddMenuEntry("Flip (F)", 4);
-	glutAttachMenu(GLUT_MIDDLE_BUTTON); // Attach the menu to the middle mouse button
+	// Create menu setup (there is no window to attach it to when headless)
+	if( headless.IsEnabled() == false )
+	{
+		menu_id = glutCreateMenu(menu);
+		glutAddMenuEntry("Toggle Wireframe (W)", 1);
+		glutAddMenuEntry("Randomize Colors (R)", 2);
+		glutAddMenuEntry("Exit (ESC)", 3);
+		glutAddMenuEntry("Flip (F)", 4);
+		glutAttachMenu(GLUT_MIDDLE_BUTTON); // Attach the menu to the middle mouse button
+	}
+
+	// Timer queries need the context, so profiling is switched on here rather than in main
+	profiler.SetOutputFile( profiling_csv );
+	profiler.SetEnabled( profiling_enabled );
 
 	std::cout << "Finished initializing...\n\n";
 }
@@ -645,6 +732,37 @@ void init( void )
 
 int main( int argc, char** argv )
 {
+	// Viewer options; GLUT's own (-display, -geometry, ...) are left alone for glutInit
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[ i ], "--continuous" ) == 0 )
+			continuous_rendering = true;
+		else if( strcmp( argv[ i ], "--profile" ) == 0 )
+			profiling_enabled = true;
+		else if( strcmp( argv[ i ], "--profile-csv" ) == 0 && i + 1 < argc )
+		{
+			profiling_enabled = true;
+			profiling_csv = argv[ ++i ];
+		}
+	}
+
+	// Without a window: render the frames, write them out and quit
+	if( headless.ParseArguments( argc, argv ) == true )
+	{
+		WindowWidth  = headless.GetWidth();
+		WindowHeight = headless.GetHeight();
+
+		if( headless.CreateContext( argc, argv ) == false )
+			return -1;
+
+		init();
+		int status = headless.Run( apply_camera_key, render_scene );
+
+		// Whatever is left since the last periodic report
+		profiler.Report();
+		return status;
+	}
+
 	// Create and initialize the OpenGL context
 	glutInit( &argc, argv );
 
@@ -664,7 +782,8 @@ int main( int argc, char** argv )
 
 	// Register callback functions
 	glutDisplayFunc( display_func );
-	glutIdleFunc( idle_func );
+	if( continuous_rendering == true )
+		glutIdleFunc( idle_func );
 	glutReshapeFunc( reshape_func );
 	glutKeyboardFunc( keyboard_func );
 	glutKeyboardUpFunc( key_released );
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include "vertexformat.h"
+
+/**
+A vertex array object together with its vertex buffers and an optional element buffer.
+The GL names are generated once and the buffers are refilled in place afterwards: storage
+only grows (geometrically), so repeated edits neither leak names nor reallocate every time.
+**/
+class MeshBuffer
+{
+public:
+	MeshBuffer();
+	~MeshBuffer();
+
+public:
+	/**
+	Generates the vertex array and its vertex buffers. Does nothing if already created.
+	*@param numBuffers Number of vertex buffers.
+	*@param usage Usage hint for every buffer's storage.
+	**/
+	void Create( GLuint numBuffers, GLenum usage = GL_DYNAMIC_DRAW );
+	void Delete();
+	void Bind() const;
+	void Unbind() const;
+
+	bool IsCreated() const { return VAO != 0; }
+
+	/**
+	Points a (floating point) vertex attribute at a vertex buffer and enables it.
+	*@param buffer Index of the vertex buffer.
+	*@param index Attribute location.
+	*@param size Number of components.
+	*@param stride Bytes between consecutive vertices, 0 for tightly packed.
+	*@param offset Byte offset of the first component.
+	**/
+	void SetAttribute( GLuint buffer, GLuint index, GLint size, GLenum type = GL_FLOAT, GLboolean normalized = GL_FALSE, GLsizei stride = 0, GLintptr offset = 0 );
+
+	/**
+	Points every attribute of an interleaved vertex format at one vertex buffer.
+	**/
+	void SetFormat( GLuint buffer, const VertexFormat& format );
+
+	/**
+	Makes an attribute advance once every divisor instances instead of once per vertex.
+	*@param index Attribute location.
+	*@param divisor 1 for per-instance data, 0 to go back to per-vertex data.
+	**/
+	void SetDivisor( GLuint index, GLuint divisor );
+
+	//@{
+	/**
+	Replaces the whole contents of a vertex buffer or of the element buffer. If the data fits the
+	current storage, the storage is orphaned and refilled; otherwise it grows to at least twice its size.
+	**/
+	void SetData( GLuint buffer, const void* data, GLsizeiptr size );
+	void SetIndexData( const void* data, GLsizeiptr size );
+	//@}
+
+	/**
+	Overwrites a byte range of a vertex buffer in place; the range must lie within the current size.
+	**/
+	void UpdateData( GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size );
+
+public:
+	GLuint GetID() const { return VAO; }
+	GLuint GetBufferID( GLuint buffer ) const { return Buffers[ buffer ].ID; }
+	GLuint GetIndexBufferID() const { return Indices.ID; }
+
+	GLsizeiptr GetSize( GLuint buffer ) const { return Buffers[ buffer ].Size; }
+	GLsizeiptr GetCapacity( GLuint buffer ) const { return Buffers[ buffer ].Capacity; }
+
+private:
+	struct Storage
+	{
+		GLuint ID;
+		GLsizeiptr Size;
+		GLsizeiptr Capacity;
+	};
+
+	void upload( GLenum target, Storage& storage, const void* data, GLsizeiptr size );
+
+	MeshBuffer( const MeshBuffer& ) = delete;
+	MeshBuffer& operator=( const MeshBuffer& ) = delete;
+
+private:
+	GLuint VAO;
+	GLenum Usage;
+	std::vector<Storage> Buffers;
+	Storage Indices;
+};
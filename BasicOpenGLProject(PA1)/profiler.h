@@ -0,0 +1,100 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+Times named passes of a frame on the CPU (steady clock) and on the GPU (GL_TIME_ELAPSED queries), and
+periodically reports the 50th/95th/99th percentile of each. GPU results are read QueryLatency frames after
+they were issued, by which time the GPU has finished them, so timing never stalls the pipeline.
+Only one pass can be open at a time: GL_TIME_ELAPSED queries don't nest.
+**/
+class Profiler
+{
+public:
+	Profiler();
+	~Profiler();
+
+public:
+	/**
+	Turns timing on or off. Queries are only generated once enabled; without timer query support
+	(GL 3.3 or ARB_timer_query) only CPU times are collected.
+	**/
+	void SetEnabled( bool enabled );
+
+	/**
+	How often a report is printed (and appended to the CSV file, if any).
+	*@param frames Number of frames per report.
+	**/
+	void SetReportInterval( int frames );
+
+	/**
+	Also appends every report to a CSV file: frame, pass, samples, CPU and GPU percentiles in milliseconds.
+	*@param path CSV file; an empty string turns the export off.
+	**/
+	void SetOutputFile( std::string path );
+
+	//@{
+	/**
+	Bracket one frame. EndFrame records the frame's CPU time and prints a report every interval.
+	**/
+	void BeginFrame();
+	void EndFrame();
+	//@}
+
+	//@{
+	/**
+	Bracket one pass of the frame. Passes are identified by name; the CPU time is the time spent
+	submitting the pass, the GPU time is the time the GPU spent executing it.
+	**/
+	void Begin( const char* name );
+	void End();
+	//@}
+
+	/**
+	Prints the percentiles gathered since the last report and starts over.
+	**/
+	void Report();
+
+public:
+	bool IsEnabled() const { return Enabled; }
+
+private:
+	static const int QueryLatency = 2;
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Pass
+	{
+		std::string Name;
+		GLuint Queries[QueryLatency];
+		bool Issued[QueryLatency];
+		std::vector<double> CpuTimes; // milliseconds, since the last report
+		std::vector<double> GpuTimes;
+	};
+
+	int findPass( const char* name );
+	void collectQueries( int slot );
+	void deleteQueries();
+	static double percentile( std::vector<double>& samples, double p );
+
+	Profiler( const Profiler& ) = delete;
+	Profiler& operator=( const Profiler& ) = delete;
+
+private:
+	bool Enabled;
+	bool TimerQueries;
+	int ReportInterval;
+	std::string OutputFile;
+
+	std::vector<Pass> Passes;
+	std::vector<double> FrameTimes;
+	int CurrentPass;
+	long long Frame;
+	int FramesSinceReport;
+
+	Clock::time_point FrameStart;
+	Clock::time_point PassStart;
+};
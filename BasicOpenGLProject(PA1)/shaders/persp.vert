@@ -4,9 +4,13 @@ layout(location=0) in vec4 in_Position;
 layout(location=1) in vec4 in_Color;
 out vec4 vert_Color;
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
+// Filled once per frame by the application and shared by every program
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	mat4 modelMatrix;
+};
 
 void main(void)
 {
@@ -4,9 +4,17 @@
 #include <glm/ext.hpp>
 
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 #include <vector>
 #include "shader.h"
 #include "shaderprogram.h"
+#include "meshbuffer.h"
+#include "uniformbuffer.h"
+#include "headless.h"
+#include "profiler.h"
+#include "vertexformat.h"
+#include "torus.h"
 
 /*=================================================================================================
 	DOMAIN
@@ -18,6 +26,11 @@ const int InitWindowHeight = 800;
 int WindowWidth  = InitWindowWidth;
 int WindowHeight = InitWindowHeight;
 
+// Renders a scripted camera path into image files instead of opening a window (--headless).
+// Declared before every GL object: globals are destroyed in reverse order, and this one's
+// destructor tears down the context the others still delete their names in
+HeadlessMode headless;
+
 // Last mouse cursor position
 int LastMousePosX = 0;
 int LastMousePosY = 0;
@@ -41,12 +54,16 @@ int centerZ = 0;
 
 
 //Initializing torus items
-GLuint torus_VAO;
-GLuint torus_VBO[2];
+MeshBuffer torus_Buffer;
+
+TorusMesh torus;
+VertexFormat torusFormat;
+std::vector<unsigned char> torusPacked;
 
-int Size = 0;
-std::vector<float> torusColors;
-std::vector<float> torusVertices;
+// The one torus mesh is drawn once per instance, each with its own offset, scale and tint
+const int MaxTorusInstances = 262144;
+int torusInstances = 1;
+std::vector<float> torusInstanceData; // offset xyz + scale, then rgba tint: 8 floats per instance
 
 
 /*=================================================================================================
@@ -60,9 +77,35 @@ glm::mat4 PerspProjectionMatrix( 1.0f );
 glm::mat4 PerspViewMatrix( 1.0f );
 glm::mat4 PerspModelMatrix( 1.0f );
 
+// Places the torus within the model; moving it only changes this matrix, never the mesh
+glm::mat4 TorusObjectMatrix( 1.0f );
+
+// Mirrors the std140 Camera block in the shaders (mat4 members need no padding)
+struct CameraUniforms
+{
+	glm::mat4 projectionMatrix;
+	glm::mat4 viewMatrix;
+	glm::mat4 modelMatrix;
+};
+
+// Uploaded once per frame and read by every program through the same binding point
+const GLuint CameraBinding = 0;
+UniformBuffer CameraBuffer;
+
 float perspZoom = 1.0f, perspSensitivity = 0.35f;
 float perspRotationX = 0.0f, perspRotationY = 0.0f;
 
+// Set whenever an input changes the camera or model transform; the matrices are only rebuilt then
+bool transforms_dirty = true;
+
+// Draw a new frame on every idle cycle instead of only after a change (--continuous, for benchmarking)
+bool continuous_rendering = false;
+
+// Per-pass CPU and GPU timings, reported every 120 frames (--profile, --profile-csv FILE)
+Profiler profiler;
+bool profiling_enabled = false;
+std::string profiling_csv = "";
+
 /*=================================================================================================
 	OBJECTS
 =================================================================================================*/
@@ -130,10 +173,18 @@ void CreateTransformationMatrices( void )
 	PerspModelMatrix = glm::rotate( PerspModelMatrix, glm::radians( perspRotationX ), glm::vec3( 1.0, 0.0, 0.0 ) );
 	PerspModelMatrix = glm::rotate( PerspModelMatrix, glm::radians( perspRotationY ), glm::vec3( 0.0, 1.0, 0.0 ) );
 	PerspModelMatrix = glm::scale( PerspModelMatrix, glm::vec3( perspZoom ) );
+
+	// Upload once; every program with a Camera block reads it from the binding point
+	CameraUniforms camera = { PerspProjectionMatrix, PerspViewMatrix, PerspModelMatrix };
+	CameraBuffer.Create( CameraBinding, sizeof( camera ) );
+	CameraBuffer.SetData( &camera );
 }
 
 void CreateShaders( void )
 {
+	// Submit every program first, then collect all compile/link results together
+	ShaderProgram::BeginBatch();
+
 	// Renders without any transformations
 	PassthroughShader.Create( "./shaders/simple.vert", "./shaders/simple.frag" );
 
@@ -143,6 +194,12 @@ void CreateShaders( void )
 	//
 	// Additional shaders would be defined here
 	//
+
+	ShaderProgram::EndBatch();
+
+	// The camera matrices come from the shared uniform buffer instead of per-program uniforms
+	PassthroughShader.SetUniformBlockBinding( "Camera", CameraBinding );
+	PerspectiveShader.SetUniformBlockBinding( "Camera", CameraBinding );
 }
 
 /*=================================================================================================
@@ -179,252 +236,81 @@ void CreateAxisBuffers( void )
 
 void CreateTorusBuffers(void)
 {
-	// generate a vertex array object(VAO)
-	glGenVertexArrays(1, &torus_VAO);
-
-	// bind the VAO
-	glBindVertexArray(torus_VAO);
-
-	glGenBuffers(2, &torus_VBO[0]); //generate 2 buffers for data, their IDs are returned to the axis_VBO array
+	// the VAO and its buffer are only generated the first time, afterwards they are refilled in place
+	if (torus_Buffer.IsCreated() == false) {
+		torus_Buffer.Create(2);
+
+		// vec3 position and RGBA8 color interleaved into 16 bytes per vertex
+		torusFormat.Add(VERTEX_POSITION, 0, 3, GL_FLOAT);
+		torusFormat.Add(VERTEX_COLOR, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+		torus_Buffer.SetFormat(0, torusFormat);
+
+		// second buffer: per-instance offset/scale (attribute 3) and tint (attribute 4), 32 bytes per instance
+		torus_Buffer.SetAttribute(1, 3, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
+		torus_Buffer.SetAttribute(1, 4, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 4 * sizeof(float));
+		torus_Buffer.SetDivisor(3, 1);
+		torus_Buffer.SetDivisor(4, 1);
+	}
 
-	// first buffer: vertex coordinates
-	glBindBuffer(GL_ARRAY_BUFFER, torus_VBO[0]);
-	// allocate storage and copy vertex coordinates into the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(torusVertices[0]) * torusVertices.size(), &torusVertices[0], GL_STATIC_DRAW);
-	// specify the layout of the vertex data for the vertex shader
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	// enable the vertex attribute at index 0
-	glEnableVertexAttribArray(0);
+	torusFormat.Pack(torus.GetVertices().data(), torus.GetColors().data(), NULL, torus.GetVertexCount(), torusPacked);
+	torus_Buffer.SetData(0, torusPacked.data(), torusPacked.size());
 
-	// second buffer: colors
-	glBindBuffer(GL_ARRAY_BUFFER, torus_VBO[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(torusColors[0]) * torusColors.size(), &torusColors[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
+	// indices into the shared vertices, the VAO remembers this binding
+	torus_Buffer.SetIndexData(torus.GetIndexData(), torus.GetIndexDataSize());
+}
 
+// lays the instances out on a cube grid that fills the axis box, tinted by their grid position
+void CreateInstanceBuffers(void)
+{
+	int side = 1;
+	while (side * side * side < torusInstances)
+		side++;
+
+	// at the default radii a torus is 1.2 across, so a cell of 1.5 leaves room between neighbors
+	float spacing = 2.0f / side;
+	float scale = (side > 1) ? spacing / 1.5f : 1.0f;
+	float tint = 0.75f / ((side > 1) ? side - 1 : 1);
+
+	torusInstanceData.resize(torusInstances * 8);
+
+	for (int n = 0; n < torusInstances; n++) {
+		int i = n % side;
+		int j = (n / side) % side;
+		int k = n / (side * side);
+
+		float* instance = &torusInstanceData[n * 8];
+		instance[0] = (side > 1) ? -1.0f + spacing * (i + 0.5f) : 0.0f;
+		instance[1] = (side > 1) ? -1.0f + spacing * (j + 0.5f) : 0.0f;
+		instance[2] = (side > 1) ? -1.0f + spacing * (k + 0.5f) : 0.0f;
+		instance[3] = scale;
+
+		instance[4] = 1.0f - tint * i;
+		instance[5] = 1.0f - tint * j;
+		instance[6] = 1.0f - tint * k;
+		instance[7] = 1.0f;
+	}
 
-	glBindVertexArray(0); //unbind when done
+	// only this buffer changes with the instance count, the mesh itself stays on the GPU
+	torus_Buffer.SetData(1, torusInstanceData.data(), sizeof(float) * torusInstanceData.size());
 }
 
+// generate at specific coordinates
+void generateTorusAt(float centerX, float centerY, float centerZ, float rad1, float rad2, float slices, float loops) {
+	// no lighting here, so the normal stream stays (0, 0, 0, 1) and is never uploaded
+	torus.SetNormalMode(TORUS_NORMALS_NONE);
+	torus.SetColor(0.5f, 0.5f, 0.5f, 0.5f);
+	torus.Generate(centerX, centerY, centerZ, rad1, rad2, (int)slices, (int)loops);
+}
 
-// generate the vertex and color data for a torus
+// generate the vertex and color data for a torus at the origin
 void makeTorus(float rad1, float rad2, float slices, float loops) {
-	// set size counter and clear existing data
-	Size = 0;
-	torusVertices.clear();
-	torusColors.clear();
-
-	// outer loop for vertical sections of the torus
-	for (int j = 0; j <= loops; ++j) {
-		float u1 = j / loops; //u1 representing the position along the loop section (from 0 to 1).
-		float loopAngle1 = u1 * 2.0f * 3.14f;  // converts u1 to an angle in radians, representing the rotation around the torus.
-		float cosLoops1 = cos(loopAngle1);  // computes the cosine of the rotation angle.	
-		float sinLoops1 = sin(loopAngle1); // computes the sine of the rotation angle.
-
-		float u2 = (j + 1) / loops; //u2 representing the position along the loop section (from 0 to 1) for the next vertex.
-		float loopAngle2 = u2 * 2.0f * 3.14f; 
-		float cosLoops2 = cos(loopAngle2);
-		float sinLoops2 = sin(loopAngle2);
-
-		// loop for slices in each vertical section
-		for (int i = 0; i <= slices; ++i) {
-			float v1 = i / slices; // v1 representing the position along the slice (from 0 to 1).
-			float sliceAngle1 = v1 * 2.0f * 3.14f; // converts v1 to an angle in radians
-			float cosSlices1 = cos(sliceAngle1); // computes the cosine of the rotation angle within the slice.
-			float sinSlices1 = sin(sliceAngle1); // computes the sine of the rotation angle within the slice.
-			float sliceRadius1 = rad1 + rad2 * cosSlices1; // calculates the radius of the slice based on the major and minor radii.
-
-			float v2 = (i + 1) / slices; // v2 representing the position along the slice (from 0 to 1) for the next vertex.
-			float sliceAngle2 = v2 * 2.0f * 3.14f; // converts v2 to an angle in radians, representing the rotation around the slice for the next vertex.
-			float cosSlices2 = cos(sliceAngle2); // computes the cosine of the rotation angle within the slice for the next vertex.
-			float sinSlices2 = sin(sliceAngle2); // computes the sine of the rotation angle within the slice for the next vertex.
-			float sliceRadius2 = rad1 + rad2 * cosSlices2; // calculates the radius of the slice for the next vertex based on the major and minor radii.
-
-			float ax = sliceRadius1 * cosLoops1;
-			float ay = sliceRadius1 * sinLoops1;
-			float az = sinSlices1 * rad2;
-
-			float ax1 = sliceRadius1 * cosLoops2;
-			float ay1 = sliceRadius1 * sinLoops2;
-			float az1 = sinSlices1 * rad2;
-
-			float bx = sliceRadius2 * cosLoops1;
-			float by = sliceRadius2 * sinLoops1;
-			float bz = sinSlices2 * rad2;
-
-			float bx1 = sliceRadius2 * cosLoops2;
-			float by1 = sliceRadius2 * sinLoops2;
-			float bz1 = sinSlices2 * rad2;
-
-			//order matters because it needs to be built counterclockwise
-
-			glm::vec3 vec_flat_1 = { bx - ax1, by - ay1, bz - az1 }; // calculates a vector in the plane of the torus slice from a1 to b.
-			glm::vec3 vec_flat_2 = { ax1 - ax, ay1 - ay, az1 - az }; // calculates a vector in the plane of the torus slice from a to a1.
-
-
-			// add the coordinates for vertex a
-			torusVertices.push_back(ax);
-			torusVertices.push_back(ay);
-			torusVertices.push_back(az);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex a.
-			Size++;
-
-			// add the coordinates for vertex a1.
-			torusVertices.push_back(ax1);
-			torusVertices.push_back(ay1);
-			torusVertices.push_back(az1);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex a1.
-			Size++;
-
-			// add the coordinates for vertex b.
-			torusVertices.push_back(bx);
-			torusVertices.push_back(by);
-			torusVertices.push_back(bz);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex b.
-			Size++;
-
-			// repeat coordinates to complete first triangle.
-			torusVertices.push_back(bx);
-			torusVertices.push_back(by);
-			torusVertices.push_back(bz);
-			torusVertices.push_back(1.0f);
-			Size++;
-
-			// repeat a1 to complete 2nd triangle.
-			torusVertices.push_back(ax1);
-			torusVertices.push_back(ay1);
-			torusVertices.push_back(az1);
-			torusVertices.push_back(1.0f);
-			Size++;
-
-			// add the coordinates for vertex b1.
-			torusVertices.push_back(bx1);
-			torusVertices.push_back(by1);
-			torusVertices.push_back(bz1);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex b1.
-			Size++;
-
-
-
-			// run a color for each of our 6 points.
-			for (int k = 0; k < 6; ++k) {
-				torusColors.push_back(0.5);
-				torusColors.push_back(0.5);
-				torusColors.push_back(0.5);
-				torusColors.push_back(0.5);
-			}
-		}
-	}
+	generateTorusAt(0.0f, 0.0f, 0.0f, rad1, rad2, slices, loops);
 }
 
-// generate at specific coordinates
-void generateTorusAt(float centerX, float centerY, float centerZ, float rad1, float rad2, float slices, float loops) {
-	// set size counter and clear existing data
-	Size = 0;
-	torusVertices.clear();
-	torusColors.clear();
-
-	// outer loop for vertical sections of the torus
-	for (int j = 0; j <= loops; ++j) {
-		float u1 = j / loops; //u1 representing the position along the loop section (from 0 to 1).
-		float loopAngle1 = u1 * 2.0f * 3.14f;  // converts u1 to an angle in radians, representing the rotation around the torus.
-		float cosLoops1 = cos(loopAngle1);  // computes the cosine of the rotation angle.	
-		float sinLoops1 = sin(loopAngle1); // computes the sine of the rotation angle.
-
-		float u2 = (j + 1) / loops; //u2 representing the position along the loop section (from 0 to 1) for the next vertex.
-		float loopAngle2 = u2 * 2.0f * 3.14f;
-		float cosLoops2 = cos(loopAngle2);
-		float sinLoops2 = sin(loopAngle2);
-
-		// loop for slices in each vertical section
-		for (int i = 0; i <= slices; ++i) {
-			float v1 = i / slices; // v1 representing the position along the slice (from 0 to 1).
-			float sliceAngle1 = v1 * 2.0f * 3.14f; // converts v1 to an angle in radians
-			float cosSlices1 = cos(sliceAngle1); // computes the cosine of the rotation angle within the slice.
-			float sinSlices1 = sin(sliceAngle1); // computes the sine of the rotation angle within the slice.
-			float sliceRadius1 = rad1 + rad2 * cosSlices1; // calculates the radius of the slice based on the major and minor radii.
-
-			float v2 = (i + 1) / slices; // v2 representing the position along the slice (from 0 to 1) for the next vertex.
-			float sliceAngle2 = v2 * 2.0f * 3.14f; // converts v2 to an angle in radians, representing the rotation around the slice for the next vertex.
-			float cosSlices2 = cos(sliceAngle2); // computes the cosine of the rotation angle within the slice for the next vertex.
-			float sinSlices2 = sin(sliceAngle2); // computes the sine of the rotation angle within the slice for the next vertex.
-			float sliceRadius2 = rad1 + rad2 * cosSlices2; // calculates the radius of the slice for the next vertex based on the major and minor radii.
-
-			float ax = sliceRadius1 * cosLoops1 + centerX;
-			float ay = sliceRadius1 * sinLoops1 + centerY;
-			float az = sinSlices1 * rad2 + centerZ;
-
-			float ax1 = sliceRadius1 * cosLoops2 + centerX;
-			float ay1 = sliceRadius1 * sinLoops2 + centerY;
-			float az1 = sinSlices1 * rad2 + centerZ;
-
-			float bx = sliceRadius2 * cosLoops1 + centerX;
-			float by = sliceRadius2 * sinLoops1 + centerY;
-			float bz = sinSlices2 * rad2 + centerZ;
-
-			float bx1 = sliceRadius2 * cosLoops2 + centerX;
-			float by1 = sliceRadius2 * sinLoops2 + centerY;
-			float bz1 = sinSlices2 * rad2 + centerZ;
-
-
-			glm::vec3 vec_flat_1 = { bx - ax1, by - ay1, bz - az1 }; // calculates a vector in the plane of the torus slice from a1 to b.
-			glm::vec3 vec_flat_2 = { ax1 - ax, ay1 - ay, az1 - az }; // calculates a vector in the plane of the torus slice from a to a1.
-
-
-			// add the coordinates for vertex a
-			torusVertices.push_back(ax);
-			torusVertices.push_back(ay);
-			torusVertices.push_back(az);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex a.
-			Size++;
-
-			// add the coordinates for vertex a1.
-			torusVertices.push_back(ax1);
-			torusVertices.push_back(ay1);
-			torusVertices.push_back(az1);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex a1.
-			Size++;
-
-			// add the coordinates for vertex b.
-			torusVertices.push_back(bx);
-			torusVertices.push_back(by);
-			torusVertices.push_back(bz);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex b.
-			Size++;
-
-			// repeat coordinates to complete first triangle.
-			torusVertices.push_back(bx);
-			torusVertices.push_back(by);
-			torusVertices.push_back(bz);
-			torusVertices.push_back(1.0f);
-			Size++;
-
-			// repeat a1 to complete 2nd triangle.
-			torusVertices.push_back(ax1);
-			torusVertices.push_back(ay1);
-			torusVertices.push_back(az1);
-			torusVertices.push_back(1.0f);
-			Size++;
-
-			// add the coordinates for vertex b1.
-			torusVertices.push_back(bx1);
-			torusVertices.push_back(by1);
-			torusVertices.push_back(bz1);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex b1.
-			Size++;
-
-
-
-			// run a color for each of our 6 points.
-			for (int k = 0; k < 6; ++k) {
-				torusColors.push_back(0.5);
-				torusColors.push_back(0.5);
-				torusColors.push_back(0.5);
-				torusColors.push_back(0.5);
-			}
-		
-		}
-	}
+// the torus is built around the origin and moved to its center by its object matrix
+void UpdateTorusPlacement(void)
+{
+	TorusObjectMatrix = glm::translate(glm::mat4(1.0f), glm::vec3((float)centerX, (float)centerY, (float)centerZ));
 }
 
 
@@ -439,9 +325,16 @@ void generateTorusAt(float centerX, float centerY, float centerZ, float rad1, fl
 // http://freeglut.sourceforge.net/docs/api.php#WindowCallback
 //-----------------------------------------------------------------------------
 
+// Rebuilds the matrices and draws one new frame once the pending events are handled
+void invalidate_transforms( void )
+{
+	transforms_dirty = true;
+	glutPostRedisplay();
+}
+
+// Only registered in continuous mode; otherwise frames are drawn on demand
 void idle_func()
 {
-	//uncomment below to repeatedly draw new frames
 	glutPostRedisplay();
 }
 
@@ -451,7 +344,7 @@ void reshape_func( int width, int height )
 	WindowHeight = height;
 
 	glViewport( 0, 0, width, height );
-	glutPostRedisplay();
+	invalidate_transforms();
 }
 
 void keyboard_func( unsigned char key, int x, int y )
@@ -530,8 +423,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '1':
 		{
 			centerX += 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -539,8 +431,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '2':
 		{
 			centerX -= 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -548,8 +439,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '3':
 		{
 			centerY += 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -557,8 +447,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '4':
 		{
 			centerY -= 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -566,8 +455,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '5':
 		{
 			centerZ += 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -575,8 +463,28 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '6':
 		{
 			centerZ -= 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
+			UpdateTorusPlacement();
+
+			break;
+		}
+
+		// Twice or half as many tori; only the instance buffer is refilled
+		case '+':
+		case '=':
+		{
+			torusInstances = std::min( torusInstances * 2, MaxTorusInstances );
+			CreateInstanceBuffers();
+			std::cout << torusInstances << " tori.\n";
+
+			break;
+		}
+
+		case '-':
+		{
+			if( torusInstances > 1 )
+				torusInstances /= 2;
+			CreateInstanceBuffers();
+			std::cout << torusInstances << " tori.\n";
 
 			break;
 		}
@@ -587,7 +495,13 @@ void keyboard_func( unsigned char key, int x, int y )
 			exit( EXIT_SUCCESS );
 			break;
 		}
+
+		// Keys without a binding change nothing on screen
+		default:
+			return;
 	}
+
+	glutPostRedisplay();
 }
 
 void key_released( unsigned char key, int x, int y )
@@ -622,11 +536,16 @@ void mouse_func( int button, int state, int x, int y )
 	if( button == 3 )
 	{
 		perspZoom += 0.03f;
+		invalidate_transforms();
 	}
 	else if( button == 4 )
 	{
+		// At the zoom floor nothing changes, so nothing is redrawn
 		if( perspZoom - 0.03f > 0.0f )
+		{
 			perspZoom -= 0.03f;
+			invalidate_transforms();
+		}
 	}
 
 	mouse_states[ button ] = ( state == GLUT_DOWN );
@@ -659,6 +578,7 @@ void active_motion_func( int x, int y )
 	{
 		perspRotationY += ( x - LastMousePosX ) * perspSensitivity;
 		perspRotationX += ( y - LastMousePosY ) * perspSensitivity;
+		invalidate_transforms();
 	}
 
 	LastMousePosX = x;
@@ -671,19 +591,23 @@ void active_motion_func( int x, int y )
 	RENDERING
 =================================================================================================*/
 
-void display_func( void )
+// Draws one frame into the bound framebuffer: the window's back buffer, or the offscreen one when headless
+void render_scene( void )
 {
+	profiler.BeginFrame();
+
 	// Clear the contents of the back buffer
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-	// Update transformation matrices
-	CreateTransformationMatrices();
+	// Update transformation matrices, only if an input changed them since the last frame
+	if( transforms_dirty == true )
+	{
+		CreateTransformationMatrices();
+		transforms_dirty = false;
+	}
 
-	// Choose which shader to user, and send the transformation matrix information to it
+	// Choose which shader to use; the transformation matrices are already in the camera buffer
 	PerspectiveShader.Use();
-	PerspectiveShader.SetUniform( "projectionMatrix", glm::value_ptr( PerspProjectionMatrix ), 4, GL_FALSE, 1 );
-	PerspectiveShader.SetUniform( "viewMatrix", glm::value_ptr( PerspViewMatrix ), 4, GL_FALSE, 1 );
-	PerspectiveShader.SetUniform( "modelMatrix", glm::value_ptr( PerspModelMatrix ), 4, GL_FALSE, 1 );
 
 	// Drawing in wireframe?
 	if( draw_wireframe == true )
@@ -692,21 +616,43 @@ void display_func( void )
 		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 
 	// Bind the axis Vertex Array Object created earlier, and draw it
+	profiler.Begin( "axis" );
+	PerspectiveShader.SetUniform( "objectMatrix", glm::value_ptr( glm::mat4( 1.0f ) ), 4, GL_FALSE, 1 );
 	glBindVertexArray( axis_VAO );
 	glDrawArrays( GL_LINES, 0, 6 ); // 6 = number of vertices in the object
+	profiler.End();
 
 	//
-	glBindVertexArray(torus_VAO);
-	glDrawArrays(GL_TRIANGLES, 0, Size); // vertices appended based on size.
+	profiler.Begin( "torus" );
+	PerspectiveShader.SetUniform( "objectMatrix", glm::value_ptr( TorusObjectMatrix ), 4, GL_FALSE, 1 );
+	torus_Buffer.Bind();
+	glDrawElementsInstanced(GL_TRIANGLES, torus.GetIndexCount(), torus.GetIndexType(), (void*)0, torusInstances); // shared vertices, indexed per triangle, once per instance
+	profiler.End();
 	//
 
 	// Unbind when done
 	glBindVertexArray( 0 );
 
+	profiler.EndFrame();
+}
+
+void display_func( void )
+{
+	render_scene();
+
 	// Swap the front and back buffers
 	glutSwapBuffers();
 }
 
+// Headless mode moves the same orbit camera the mouse does
+void apply_camera_key( const CameraKey& key )
+{
+	perspRotationX = key.RotationX;
+	perspRotationY = key.RotationY;
+	perspZoom = key.Zoom;
+	transforms_dirty = true;
+}
+
 /*=================================================================================================
 	INIT
 =================================================================================================*/
@@ -724,6 +670,9 @@ void init( void )
 	glEnable( GL_DEPTH_TEST ); // enable depth test
 	glEnable( GL_CULL_FACE ); // enable back-face culling
 
+	// Objects drawn without an instance buffer (the axis) read this constant instead: no tint
+	glVertexAttrib4f( 4, 1.0f, 1.0f, 1.0f, 1.0f );
+
 	// Create shaders
 	CreateShaders();
 
@@ -732,11 +681,16 @@ void init( void )
 
 	//
 	makeTorus(outerRad, innerRad, Slices, Loops);
-	generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
 	CreateTorusBuffers();
+	CreateInstanceBuffers();
+	UpdateTorusPlacement();
 
 	//
 
+	// Timer queries need the context, so profiling is switched on here rather than in main
+	profiler.SetOutputFile( profiling_csv );
+	profiler.SetEnabled( profiling_enabled );
+
 	std::cout << "Finished initializing...\n\n";
 }
 
@@ -746,6 +700,39 @@ void init( void )
 
 int main( int argc, char** argv )
 {
+	// Viewer options; GLUT's own (-display, -geometry, ...) are left alone for glutInit
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[ i ], "--continuous" ) == 0 )
+			continuous_rendering = true;
+		else if( strcmp( argv[ i ], "--instances" ) == 0 && i + 1 < argc )
+			torusInstances = std::max( 1, std::min( atoi( argv[ ++i ] ), MaxTorusInstances ) );
+		else if( strcmp( argv[ i ], "--profile" ) == 0 )
+			profiling_enabled = true;
+		else if( strcmp( argv[ i ], "--profile-csv" ) == 0 && i + 1 < argc )
+		{
+			profiling_enabled = true;
+			profiling_csv = argv[ ++i ];
+		}
+	}
+
+	// Without a window: render the frames, write them out and quit
+	if( headless.ParseArguments( argc, argv ) == true )
+	{
+		WindowWidth  = headless.GetWidth();
+		WindowHeight = headless.GetHeight();
+
+		if( headless.CreateContext( argc, argv ) == false )
+			return -1;
+
+		init();
+		int status = headless.Run( apply_camera_key, render_scene );
+
+		// Whatever is left since the last periodic report
+		profiler.Report();
+		return status;
+	}
+
 	// Create and initialize the OpenGL context
 	glutInit( &argc, argv );
 
@@ -765,7 +752,8 @@ int main( int argc, char** argv )
 
 	// Register callback functions
 	glutDisplayFunc( display_func );
-	glutIdleFunc( idle_func );
+	if( continuous_rendering == true )
+		glutIdleFunc( idle_func );
 	glutReshapeFunc( reshape_func );
 	glutKeyboardFunc( keyboard_func );
 	glutKeyboardUpFunc( key_released );
@@ -0,0 +1,241 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+Profiler::Profiler()
+{
+	Enabled = false;
+	TimerQueries = false;
+	ReportInterval = 120;
+	CurrentPass = -1;
+	Frame = 0;
+	FramesSinceReport = 0;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+Profiler::~Profiler()
+{
+	deleteQueries();
+}
+
+/*=================================================================================================
+  SETTINGS
+=================================================================================================*/
+
+void Profiler::SetEnabled( bool enabled )
+{
+	Enabled = enabled;
+
+	if( Enabled == true )
+		TimerQueries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+void Profiler::SetReportInterval( int frames )
+{
+	ReportInterval = frames > 0 ? frames : 1;
+}
+
+void Profiler::SetOutputFile( std::string path )
+{
+	OutputFile = path;
+
+	// Start the file over with a header; reports are appended to it
+	if( OutputFile.empty() == false )
+	{
+		std::ofstream file( OutputFile, std::ios::trunc );
+		file << "frame,pass,samples,cpu_p50_ms,cpu_p95_ms,cpu_p99_ms,gpu_p50_ms,gpu_p95_ms,gpu_p99_ms\n";
+	}
+}
+
+/*=================================================================================================
+  FRAMES
+=================================================================================================*/
+
+void Profiler::BeginFrame( void )
+{
+	if( Enabled == false )
+		return;
+
+	// The queries about to be reused were issued QueryLatency frames ago
+	collectQueries( (int)( Frame % QueryLatency ) );
+
+	FrameStart = Clock::now();
+}
+
+void Profiler::EndFrame( void )
+{
+	if( Enabled == false )
+		return;
+
+	FrameTimes.push_back( std::chrono::duration<double, std::milli>( Clock::now() - FrameStart ).count() );
+
+	Frame++;
+	FramesSinceReport++;
+
+	if( FramesSinceReport >= ReportInterval )
+		Report();
+}
+
+/*=================================================================================================
+  PASSES
+=================================================================================================*/
+
+int Profiler::findPass( const char* name )
+{
+	// A frame has a handful of passes, a linear search beats hashing here
+	for( size_t i = 0; i < Passes.size(); i++ )
+		if( Passes[i].Name == name )
+			return (int)i;
+
+	Pass pass;
+	pass.Name = name;
+	for( int i = 0; i < QueryLatency; i++ )
+	{
+		pass.Queries[i] = 0;
+		pass.Issued[i] = false;
+	}
+
+	if( TimerQueries == true )
+		glGenQueries( QueryLatency, pass.Queries );
+
+	Passes.push_back( pass );
+	return (int)Passes.size() - 1;
+}
+
+void Profiler::Begin( const char* name )
+{
+	if( Enabled == false || CurrentPass >= 0 )
+		return;
+
+	CurrentPass = findPass( name );
+
+	if( TimerQueries == true )
+	{
+		int slot = (int)( Frame % QueryLatency );
+		glBeginQuery( GL_TIME_ELAPSED, Passes[CurrentPass].Queries[slot] );
+	}
+
+	PassStart = Clock::now();
+}
+
+void Profiler::End( void )
+{
+	if( Enabled == false || CurrentPass < 0 )
+		return;
+
+	Pass& pass = Passes[CurrentPass];
+	pass.CpuTimes.push_back( std::chrono::duration<double, std::milli>( Clock::now() - PassStart ).count() );
+
+	if( TimerQueries == true )
+	{
+		glEndQuery( GL_TIME_ELAPSED );
+		pass.Issued[Frame % QueryLatency] = true;
+	}
+
+	CurrentPass = -1;
+}
+
+void Profiler::collectQueries( int slot )
+{
+	for( size_t i = 0; i < Passes.size(); i++ )
+	{
+		Pass& pass = Passes[i];
+		if( pass.Issued[slot] == false )
+			continue;
+
+		// Normally long done; only waits if the GPU has fallen more than QueryLatency frames behind
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v( pass.Queries[slot], GL_QUERY_RESULT, &elapsed );
+
+		pass.GpuTimes.push_back( (double)elapsed / 1.0e6 );
+		pass.Issued[slot] = false;
+	}
+}
+
+void Profiler::deleteQueries( void )
+{
+	for( size_t i = 0; i < Passes.size(); i++ )
+	{
+		if( Passes[i].Queries[0] != 0 )
+			glDeleteQueries( QueryLatency, Passes[i].Queries );
+	}
+
+	Passes.clear();
+}
+
+/*=================================================================================================
+  REPORT
+=================================================================================================*/
+
+// Nearest-rank percentile; sorts the samples in place
+double Profiler::percentile( std::vector<double>& samples, double p )
+{
+	if( samples.empty() == true )
+		return 0.0;
+
+	std::sort( samples.begin(), samples.end() );
+
+	size_t rank = (size_t)( p / 100.0 * samples.size() + 0.999999 );
+	if( rank < 1 )
+		rank = 1;
+	if( rank > samples.size() )
+		rank = samples.size();
+
+	return samples[rank - 1];
+}
+
+void Profiler::Report( void )
+{
+	if( FramesSinceReport == 0 )
+		return;
+
+	std::ofstream csv;
+	if( OutputFile.empty() == false )
+		csv.open( OutputFile, std::ios::app );
+
+	printf( "Profile of %d frames (ending at frame %lld), milliseconds\n", FramesSinceReport, Frame );
+	printf( "  %-16s %8s %8s %8s   %8s %8s %8s\n", "pass", "cpu p50", "p95", "p99", "gpu p50", "p95", "p99" );
+
+	for( int i = -1; i < (int)Passes.size(); i++ )
+	{
+		// Row -1 is the whole frame, which only has a CPU time
+		std::vector<double> empty;
+		std::vector<double>& cpu = i < 0 ? FrameTimes : Passes[i].CpuTimes;
+		std::vector<double>& gpu = i < 0 ? empty : Passes[i].GpuTimes;
+		const char* name = i < 0 ? "frame" : Passes[i].Name.c_str();
+
+		if( cpu.empty() == true )
+			continue;
+
+		size_t samples = cpu.size();
+		double c50 = percentile( cpu, 50.0 ), c95 = percentile( cpu, 95.0 ), c99 = percentile( cpu, 99.0 );
+
+		if( gpu.empty() == false )
+		{
+			double g50 = percentile( gpu, 50.0 ), g95 = percentile( gpu, 95.0 ), g99 = percentile( gpu, 99.0 );
+			printf( "  %-16s %8.3f %8.3f %8.3f   %8.3f %8.3f %8.3f\n", name, c50, c95, c99, g50, g95, g99 );
+			if( csv.is_open() == true )
+				csv << Frame << "," << name << "," << samples << "," << c50 << "," << c95 << "," << c99 << "," << g50 << "," << g95 << "," << g99 << "\n";
+		}
+		else
+		{
+			printf( "  %-16s %8.3f %8.3f %8.3f   %8s %8s %8s\n", name, c50, c95, c99, "-", "-", "-" );
+			if( csv.is_open() == true )
+				csv << Frame << "," << name << "," << samples << "," << c50 << "," << c95 << "," << c99 << ",,,\n";
+		}
+
+		cpu.clear();
+		gpu.clear();
+	}
+
+	printf( "\n" );
+	FramesSinceReport = 0;
+}
@@ -31,14 +31,16 @@ Shader::~Shader()
   CREATE
 =================================================================================================*/
 
-void Shader::Create( std::string shaderPath, GLenum shaderType )
+// load = false only creates the shader object; Load() compiles it later
+void Shader::Create( std::string shaderPath, GLenum shaderType, bool load )
 {
 	ID = glCreateShader( shaderType );
 
 	Type = shaderType;
 	Path = shaderPath;
 
-	Load();
+	if( load == true )
+		Load();
 }
 
 /*=================================================================================================
@@ -59,36 +61,80 @@ void Shader::Delete( void )
 =================================================================================================*/
 
 void Shader::Load( void )
+{
+	Compile();
+	CheckCompileStatus();
+}
+
+/*=================================================================================================
+  COMPILE
+=================================================================================================*/
+
+// Starts compilation without asking for the result, so the driver is free to finish it later
+void Shader::Compile( void )
 {
 	if( ID == 0 )
 		return;
 
-	std::ifstream srcFile( Path );
-	std::string shaderSrc, line;
+	std::string shaderSrc;
 
-	if( srcFile.is_open() == true )
+	if( ReadSource( shaderSrc ) == true )
 	{
-		while( std::getline( srcFile, line ) )
-		{
-			shaderSrc += line;
-			shaderSrc += '\n';
-		}
-		srcFile.close();
-
 		const char* src = shaderSrc.c_str();
 
 		glShaderSource( ID, 1, &src, NULL );
 
 		glCompileShader( ID );
-
-		// If the shader didn't compile successfully, print log
-		if( GetCompileStatus() == 0 )
-			std::cerr << Path << std::endl << GetInfoLog() << std::endl;
 	}
 	else
 		std::cerr << "Unable to open shader file: " << Path << std::endl;
 }
 
+// Waits for compilation; if the shader didn't compile successfully, prints its log
+bool Shader::CheckCompileStatus( void ) const
+{
+	if( ID == 0 )
+		return true;
+
+	// No source means the file couldn't be opened, which Compile() already reported
+	GLint sourceLength = 0;
+	glGetShaderiv( ID, GL_SHADER_SOURCE_LENGTH, &sourceLength );
+	if( sourceLength == 0 )
+		return false;
+
+	if( GetCompileStatus() == 0 )
+	{
+		std::cerr << Path << std::endl << GetInfoLog() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+/*=================================================================================================
+  READ SOURCE (from file)
+=================================================================================================*/
+
+bool Shader::ReadSource( std::string& source ) const
+{
+	std::ifstream srcFile( Path );
+	std::string line;
+
+	source = "";
+
+	if( srcFile.is_open() == false )
+		return false;
+
+	while( std::getline( srcFile, line ) )
+	{
+		source += line;
+		source += '\n';
+	}
+	srcFile.close();
+
+	return true;
+}
+
 /*=================================================================================================
   GET STATUS
 =================================================================================================*/
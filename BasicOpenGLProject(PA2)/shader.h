@@ -12,9 +12,12 @@ public:
 	~Shader();
 
 public:
-	void Create( std::string shaderPath, GLenum shaderType );
+	void Create( std::string shaderPath, GLenum shaderType, bool load = true );
 	void Delete();
 	void Load();
+	void Compile();
+	bool CheckCompileStatus() const;
+	bool ReadSource( std::string& source ) const;
 
 public:
 	int GetStatus( GLenum ) const;
@@ -2,14 +2,25 @@
 
 layout(location=0) in vec4 in_Position;
 layout(location=1) in vec4 in_Color;
+layout(location=3) in vec4 in_InstanceOffset; // xyz offset, w scale; (0, 0, 0, 1) when not instanced
+layout(location=4) in vec4 in_InstanceColor;  // multiplies in_Color
 out vec4 vert_Color;
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
+// Filled once per frame by the application and shared by every program
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	mat4 modelMatrix;
+};
+
+// Places one object within the model, set before each draw
+uniform mat4 objectMatrix = mat4( 1.0 );
 
 void main(void)
 {
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4( in_Position.xyz, 1.0 );
-	vert_Color = in_Color;
+	vec3 position = in_Position.xyz * in_InstanceOffset.w + in_InstanceOffset.xyz;
+
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * objectMatrix * vec4( position, 1.0 );
+	vert_Color = in_Color * in_InstanceColor;
 }
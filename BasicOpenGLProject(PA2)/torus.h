@@ -0,0 +1,80 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+// What TorusMesh::Generate writes into the normal stream
+enum TorusNormalMode
+{
+	TORUS_NORMALS_NONE,   // (0, 0, 0, 1) everywhere
+	TORUS_NORMALS_FACE,   // each vertex carries the normal of the quad it is the provoking vertex of
+	TORUS_NORMALS_VERTEX  // from the tube's center line out to the vertex
+};
+
+class TorusMesh
+{
+public:
+	TorusMesh();
+
+public:
+	/**
+	Builds a (loops+1) x (slices+1) grid of shared vertices and the triangle indices that stitch it.
+	The last row and column duplicate the first ones so the seam can carry its own attributes.
+	Both triangles of a quad end on the quad's first corner, so with the default (last vertex)
+	provoking convention a flat-qualified attribute reads TORUS_NORMALS_FACE as per-face normals.
+	*@param centerX,centerY,centerZ Center of the torus.
+	*@param rad1 Distance from the center to the middle of the tube.
+	*@param rad2 Radius of the tube.
+	*@param slices Subdivisions around the tube.
+	*@param loops Subdivisions around the center.
+	**/
+	void Generate( float centerX, float centerY, float centerZ, float rad1, float rad2, int slices, int loops );
+	void Clear();
+
+	void SetColor( float r, float g, float b, float a );
+	void SetNormalMode( TorusNormalMode mode ) { NormalMode = mode; }
+
+	// Worker threads Generate may split large grids across; 0 uses every hardware thread
+	void SetThreadCount( int count ) { ThreadCount = count; }
+
+public:
+	const std::vector<float>& GetVertices() const { return Vertices; }
+	const std::vector<float>& GetColors()   const { return Colors;   }
+	const std::vector<float>& GetNormals()  const { return Normals;  }
+
+	GLsizei GetVertexCount() const { return (GLsizei)( Vertices.size() / 4 ); }
+	GLsizei GetIndexCount()  const;
+
+	// GL_UNSIGNED_SHORT while every vertex fits in 16 bits, GL_UNSIGNED_INT beyond that
+	GLenum      GetIndexType()     const;
+	const void* GetIndexData()     const;
+	GLsizeiptr  GetIndexDataSize() const;
+
+private:
+	void generateRows( int firstRow, int lastRow );
+
+private:
+	std::vector<float> Vertices; // xyzw per vertex
+	std::vector<float> Colors;   // rgba per vertex
+	std::vector<float> Normals;  // xyzw per vertex, w = 1
+
+	std::vector<GLushort> Indices16;
+	std::vector<GLuint>   Indices32;
+
+	// Cosine and sine of every loop and slice angle, kept between calls to reuse their storage
+	std::vector<float> LoopCos;
+	std::vector<float> LoopSin;
+	std::vector<float> SliceCos;
+	std::vector<float> SliceSin;
+
+	float Color[4];
+	TorusNormalMode NormalMode;
+	int ThreadCount;
+
+	// Parameters of the last Generate call
+	float Center[3];
+	float MajorRadius;
+	float MinorRadius;
+	int Slices;
+	int Loops;
+};
@@ -0,0 +1,78 @@
+#include "uniformbuffer.h"
+#include <cstddef>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+UniformBuffer::UniformBuffer()
+{
+	ID = 0;
+	Binding = 0;
+	Size = 0;
+	Usage = GL_DYNAMIC_DRAW;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+UniformBuffer::~UniformBuffer()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+void UniformBuffer::Create( GLuint binding, GLsizeiptr size, GLenum usage )
+{
+	if( ID != 0 )
+		return;
+
+	Binding = binding;
+	Size = size;
+	Usage = usage;
+
+	glGenBuffers( 1, &ID );
+	glBindBuffer( GL_UNIFORM_BUFFER, ID );
+	glBufferData( GL_UNIFORM_BUFFER, Size, NULL, Usage );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+	// The binding point keeps the buffer attached no matter which program is in use
+	glBindBufferBase( GL_UNIFORM_BUFFER, Binding, ID );
+}
+
+void UniformBuffer::Delete( void )
+{
+	if( ID == 0 )
+		return;
+
+	glDeleteBuffers( 1, &ID );
+
+	ID = 0;
+	Size = 0;
+}
+
+/*=================================================================================================
+  DATA
+=================================================================================================*/
+
+void UniformBuffer::SetData( const void* data )
+{
+	glBindBuffer( GL_UNIFORM_BUFFER, ID );
+	glBufferData( GL_UNIFORM_BUFFER, Size, NULL, Usage );
+	glBufferSubData( GL_UNIFORM_BUFFER, 0, Size, data );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+}
+
+void UniformBuffer::UpdateData( GLintptr offset, const void* data, GLsizeiptr size )
+{
+	if( size <= 0 || offset + size > Size )
+		return;
+
+	glBindBuffer( GL_UNIFORM_BUFFER, ID );
+	glBufferSubData( GL_UNIFORM_BUFFER, offset, size, data );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+}
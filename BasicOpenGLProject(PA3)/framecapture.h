@@ -0,0 +1,66 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+
+/**
+An offscreen framebuffer (RGBA8 color, 24-bit depth) whose frames are written to disk as binary PPM.
+Readbacks go through two pixel buffer objects used in turn: a frame's glReadPixels only queues a copy,
+and it is mapped and written while the next frame renders, so the CPU never waits on the frame it just drew.
+**/
+class FrameCapture
+{
+public:
+	FrameCapture();
+	~FrameCapture();
+
+public:
+	/**
+	Generates the framebuffer, its attachments and the readback buffers. Does nothing if already created.
+	*@return false if the framebuffer is incomplete.
+	**/
+	bool Create( GLsizei width, GLsizei height );
+	void Delete();
+
+	/**
+	Makes the offscreen framebuffer the draw and read target and covers it with the viewport.
+	**/
+	void Bind() const;
+	void Unbind() const;
+
+	/**
+	Queues a readback of the bound framebuffer, then writes the previously queued frame.
+	*@param path Where this frame is written once its pixels arrive.
+	**/
+	void Capture( const std::string& path );
+
+	/**
+	Writes the frame still waiting in its pixel buffer; call it after the last Capture.
+	**/
+	void Finish();
+
+	/**
+	Writes bottom-up RGBA pixels (as glReadPixels returns them) into a binary PPM file.
+	**/
+	static bool WritePPM( const std::string& path, const unsigned char* pixels, GLsizei width, GLsizei height );
+
+public:
+	GLuint GetID() const { return FBO; }
+	GLsizei GetWidth() const { return Width; }
+	GLsizei GetHeight() const { return Height; }
+
+private:
+	void writePending( int index );
+
+	FrameCapture( const FrameCapture& ) = delete;
+	FrameCapture& operator=( const FrameCapture& ) = delete;
+
+private:
+	GLuint FBO;
+	GLuint ColorRenderbuffer, DepthRenderbuffer;
+	GLuint PixelBuffers[2];
+	std::string PendingPaths[2]; // empty when nothing is waiting in that pixel buffer
+	int Next;
+
+	GLsizei Width, Height;
+};
@@ -0,0 +1,252 @@
+#include "headless.h"
+#include "framecapture.h"
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined( __linux__ ) && !defined( HEADLESS_NO_EGL )
+#define HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+HeadlessMode::HeadlessMode()
+{
+	Enabled = false;
+	Frames = 120;
+	Width = 800;
+	Height = 800;
+	OutputDirectory = ".";
+
+	Display = NULL;
+	Surface = NULL;
+	Context = NULL;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+HeadlessMode::~HeadlessMode()
+{
+	destroyEGLContext();
+}
+
+/*=================================================================================================
+  ARGUMENTS
+=================================================================================================*/
+
+bool HeadlessMode::ParseArguments( int argc, char** argv )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		bool hasValue = i + 1 < argc;
+
+		if( strcmp( argv[i], "--headless" ) == 0 )
+			Enabled = true;
+		else if( strcmp( argv[i], "--frames" ) == 0 && hasValue == true )
+			Frames = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--camera-path" ) == 0 && hasValue == true )
+			CameraPathFile = argv[++i];
+		else if( strcmp( argv[i], "--output" ) == 0 && hasValue == true )
+			OutputDirectory = argv[++i];
+		else if( strcmp( argv[i], "--size" ) == 0 && hasValue == true )
+		{
+			int width = 0, height = 0;
+			if( sscanf( argv[++i], "%dx%d", &width, &height ) == 2 && width > 0 && height > 0 )
+			{
+				Width = width;
+				Height = height;
+			}
+			else
+				std::cerr << "ignoring --size " << argv[i] << ", expected WIDTHxHEIGHT" << std::endl;
+		}
+	}
+
+	if( Frames < 1 )
+		Frames = 1;
+
+	return Enabled;
+}
+
+/*=================================================================================================
+  CONTEXT
+=================================================================================================*/
+
+bool HeadlessMode::CreateContext( int& argc, char** argv )
+{
+	if( createEGLContext() == false )
+	{
+		// Needs a display server, but not a GPU
+		glutInit( &argc, argv );
+		glutInitWindowSize( Width, Height );
+		glutInitDisplayMode( GLUT_RGBA | GLUT_DEPTH );
+		glutCreateWindow( "CSE-170 Computer Graphics (headless)" );
+		glutHideWindow();
+	}
+
+	GLenum ret = glewInit();
+
+	// GLEW built for GLX loads every GL entry point first and only then fails to find an X display
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	if( ret == GLEW_ERROR_NO_GLX_DISPLAY && Context != NULL )
+		ret = GLEW_OK;
+#endif
+
+	if( ret != GLEW_OK )
+	{
+		std::cerr << "GLEW initialization error: " << glewGetErrorString( ret ) << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool HeadlessMode::createEGLContext( void )
+{
+#ifdef HEADLESS_EGL
+	EGLDisplay display = EGL_NO_DISPLAY;
+
+	// Prefer Mesa's surfaceless platform: it needs neither X11 nor Wayland nor a render node
+	const char* clientExtensions = eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+	if( clientExtensions != NULL && strstr( clientExtensions, "EGL_MESA_platform_surfaceless" ) != NULL )
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+		if( getPlatformDisplay != NULL )
+			display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+	}
+
+	if( display == EGL_NO_DISPLAY )
+		display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	EGLint major = 0, minor = 0;
+	if( display == EGL_NO_DISPLAY || eglInitialize( display, &major, &minor ) == EGL_FALSE )
+		return false;
+
+	Display = display;
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if( eglChooseConfig( display, configAttributes, &config, 1, &numConfigs ) == EGL_FALSE || numConfigs < 1 || eglBindAPI( EGL_OPENGL_API ) == EGL_FALSE )
+	{
+		destroyEGLContext();
+		return false;
+	}
+
+	// The viewers draw through the framebuffer object, the pbuffer only has to make the context current
+	const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+	EGLSurface surface = eglCreatePbufferSurface( display, config, surfaceAttributes );
+	Surface = surface;
+
+	// Same kind of context freeglut gives the windowed viewers: compatibility profile, newest version
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+
+	EGLContext context = eglCreateContext( display, config, EGL_NO_CONTEXT, contextAttributes );
+	if( context == EGL_NO_CONTEXT || surface == EGL_NO_SURFACE || eglMakeCurrent( display, surface, surface, context ) == EGL_FALSE )
+	{
+		if( context != EGL_NO_CONTEXT )
+			eglDestroyContext( display, context );
+		destroyEGLContext();
+		return false;
+	}
+
+	Context = context;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void HeadlessMode::destroyEGLContext( void )
+{
+#ifdef HEADLESS_EGL
+	if( Display == NULL )
+		return;
+
+	eglMakeCurrent( (EGLDisplay)Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+
+	if( Context != NULL )
+		eglDestroyContext( (EGLDisplay)Display, (EGLContext)Context );
+	if( Surface != NULL )
+		eglDestroySurface( (EGLDisplay)Display, (EGLSurface)Surface );
+
+	eglTerminate( (EGLDisplay)Display );
+#endif
+
+	Display = NULL;
+	Surface = NULL;
+	Context = NULL;
+}
+
+/*=================================================================================================
+  RUN
+=================================================================================================*/
+
+int HeadlessMode::Run( void ( *applyCamera )( const CameraKey& key ), void ( *render )() )
+{
+	CameraPath path;
+
+	// The default turn ends where it starts, so its last frame is left for the first one to close
+	bool closedLoop = CameraPathFile.empty();
+
+	if( CameraPathFile.empty() == false )
+	{
+		if( path.Load( CameraPathFile ) == false )
+			return EXIT_FAILURE;
+	}
+	else
+	{
+		path.AddKey( 0.0f, 20.0f, 0.0f, 1.0f );
+		path.AddKey( 1.0f, 20.0f, 360.0f, 1.0f );
+	}
+
+	FrameCapture capture;
+	if( capture.Create( Width, Height ) == false )
+		return EXIT_FAILURE;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for( int frame = 0; frame < Frames; frame++ )
+	{
+		float s;
+		if( closedLoop == true )
+			s = (float)frame / (float)Frames;
+		else
+			s = Frames > 1 ? (float)frame / (float)( Frames - 1 ) : 0.0f;
+		applyCamera( path.Evaluate( path.GetStartTime() + s * ( path.GetEndTime() - path.GetStartTime() ) ) );
+
+		capture.Bind();
+		render();
+
+		char name[32];
+		snprintf( name, sizeof( name ), "frame_%04d.ppm", frame );
+		capture.Capture( OutputDirectory + "/" + name );
+	}
+
+	capture.Finish();
+	capture.Unbind();
+
+	double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	std::cout << "Rendered " << Frames << " frames (" << Width << "x" << Height << ") to " << OutputDirectory << " in "
+		<< milliseconds << " ms, " << milliseconds / Frames << " ms per frame\n";
+
+	return EXIT_SUCCESS;
+}
@@ -4,9 +4,17 @@
 #include <glm/ext.hpp>
 
 #include <iostream>
+#include <cstring>
 #include <vector>
 #include "shader.h"
 #include "shaderprogram.h"
+#include "meshbuffer.h"
+#include "uniformbuffer.h"
+#include "headless.h"
+#include "profiler.h"
+#include "vertexformat.h"
+#include "torus.h"
+#include "torustessellator.h"
 
 /*=================================================================================================
 	DOMAIN
@@ -18,6 +26,11 @@ const int InitWindowHeight = 800;
 int WindowWidth  = InitWindowWidth;
 int WindowHeight = InitWindowHeight;
 
+// Renders a scripted camera path into image files instead of opening a window (--headless).
+// Declared before every GL object: globals are destroyed in reverse order, and this one's
+// destructor tears down the context the others still delete their names in
+HeadlessMode headless;
+
 // Last mouse cursor position
 int LastMousePosX = 0;
 int LastMousePosY = 0;
@@ -39,17 +52,20 @@ float centerX = 0;
 float centerY = 0;
 float centerZ = 0;
 
-int Size = 0;
-
-
-std::vector<float> torusColors;
-std::vector<float> torusVertices;
-std::vector<float> normals;
+TorusMesh torus;
 
-std::vector<float> normLinesColors;
-std::vector<float> normLinesVertices;
+// How torus vertices are laid out on the GPU, cycled with 'v'
+enum TorusLayout { LAYOUT_FLOAT_STREAMS, LAYOUT_PACKED, LAYOUT_COMPRESSED };
+int torusLayout = LAYOUT_PACKED;
+VertexFormat torusFormat;           // LAYOUT_PACKED
+VertexFormat torusCompressedFormat; // LAYOUT_COMPRESSED
+std::vector<unsigned char> torusPacked;
 
+// Generates the torus straight into its buffers with a compute shader instead of on the CPU, toggled with 't' (--gpu-torus)
+TorusTessellator torusTessellator;
+bool torusOnGPU = false;
 
+// The normal lines are drawn from the torus buffers by a geometry shader, no copy of them is kept
 bool showNormLines = true;
 
 //Shading bools
@@ -64,14 +80,52 @@ bool smoothShadingEnabled = true;
 ShaderProgram PassthroughShader;
 ShaderProgram PerspectiveShader;
 ShaderProgram PerspLightShader; // New ShaderProgram instance for persplight shaders
+ShaderProgram NormalLinesShader;
 
 glm::mat4 PerspProjectionMatrix( 1.0f );
 glm::mat4 PerspViewMatrix( 1.0f );
 glm::mat4 PerspModelMatrix( 1.0f );
 
+// Derived once per frame so the lighting shader does not invert a matrix per fragment
+glm::mat4 PerspModelViewMatrix( 1.0f );
+glm::mat3 PerspNormalMatrix( 1.0f );
+glm::vec3 PerspLightPosition( 0.0f );
+
+// The light sits at a fixed point of the model, so it turns along with the torus
+const glm::vec4 ModelLightPosition( 3.0f, 0.0f, 3.0f, 1.0f );
+
+// Places the torus and its normal lines within the model; moving them only changes this matrix, never the mesh
+glm::mat4 TorusObjectMatrix( 1.0f );
+
+// Mirrors the std140 Camera block in the shaders; the normal matrix is widened to a mat4 so no member needs padding
+struct CameraUniforms
+{
+	glm::mat4 projectionMatrix;
+	glm::mat4 viewMatrix;
+	glm::mat4 modelMatrix;
+	glm::mat4 modelViewMatrix;
+	glm::mat4 normalMatrix;
+	glm::vec4 lightPosition;
+};
+
+// Uploaded once per frame and read by every program through the same binding point
+const GLuint CameraBinding = 0;
+UniformBuffer CameraBuffer;
+
 float perspZoom = 1.0f, perspSensitivity = 0.35f;
 float perspRotationX = 0.0f, perspRotationY = 0.0f;
 
+// Set whenever an input changes the camera or model transform; the matrices are only rebuilt then
+bool transforms_dirty = true;
+
+// Draw a new frame on every idle cycle instead of only after a change (--continuous, for benchmarking)
+bool continuous_rendering = false;
+
+// Per-pass CPU and GPU timings, reported every 120 frames (--profile, --profile-csv FILE)
+Profiler profiler;
+bool profiling_enabled = false;
+std::string profiling_csv = "";
+
 /*=================================================================================================
 	OBJECTS
 =================================================================================================*/
@@ -83,11 +137,7 @@ GLuint axis_VAO;
 GLuint axis_VBO[2];
 
 //Initializing torus items
-GLuint torus_VAO;
-GLuint torus_VBO[3];
-
-GLuint normLines_VAO;
-GLuint normLines_VBO[2];
+MeshBuffer torus_Buffer;
 
 float axis_vertices[] = {
 	//x axis
@@ -146,19 +196,43 @@ void CreateTransformationMatrices( void )
 	PerspModelMatrix = glm::rotate( PerspModelMatrix, glm::radians( perspRotationX ), glm::vec3( 1.0, 0.0, 0.0 ) );
 	PerspModelMatrix = glm::rotate( PerspModelMatrix, glm::radians( perspRotationY ), glm::vec3( 0.0, 1.0, 0.0 ) );
 	PerspModelMatrix = glm::scale( PerspModelMatrix, glm::vec3( perspZoom ) );
+
+	// VIEW SPACE LIGHTING
+	PerspModelViewMatrix = PerspViewMatrix * PerspModelMatrix;
+	PerspNormalMatrix = glm::transpose( glm::inverse( glm::mat3( PerspModelViewMatrix ) ) );
+	PerspLightPosition = glm::vec3( PerspModelViewMatrix * ModelLightPosition );
+
+	// Upload once; every program with a Camera block reads it from the binding point
+	CameraUniforms camera = { PerspProjectionMatrix, PerspViewMatrix, PerspModelMatrix, PerspModelViewMatrix,
+		glm::mat4( PerspNormalMatrix ), glm::vec4( PerspLightPosition, 1.0f ) };
+	CameraBuffer.Create( CameraBinding, sizeof( camera ) );
+	CameraBuffer.SetData( &camera );
 }
 
 void CreateShaders( void )
 {
+	// Submit every program first, then collect all compile/link results together
+	ShaderProgram::BeginBatch();
+
 	// Renders without any transformations
 	PassthroughShader.Create( "./shaders/simple.vert", "./shaders/simple.frag" );
 
 	// Renders using perspective projection
 	PerspectiveShader.Create( "./shaders/persp.vert", "./shaders/persp.frag" );
 
-	//
-	PerspectiveShader.Create("./shaders/persplight.vert", "./shaders/persplight.frag");
-	//
+	// Renders using perspective projection and Phong lighting
+	PerspLightShader.Create( "./shaders/persplight.vert", "./shaders/persplight.frag" );
+
+	// Draws a line along the normal of every torus vertex, built in the geometry shader
+	NormalLinesShader.Create( "./shaders/normals.vert", "./shaders/normals.geom", "./shaders/persp.frag" );
+
+	ShaderProgram::EndBatch();
+
+	// The camera matrices come from the shared uniform buffer instead of per-program uniforms
+	PassthroughShader.SetUniformBlockBinding( "Camera", CameraBinding );
+	PerspectiveShader.SetUniformBlockBinding( "Camera", CameraBinding );
+	PerspLightShader.SetUniformBlockBinding( "Camera", CameraBinding );
+	NormalLinesShader.SetUniformBlockBinding( "Camera", CameraBinding );
 }
 
 /*=================================================================================================
@@ -193,327 +267,90 @@ void CreateAxisBuffers( void )
 }
 
 
-void CreateTorusBuffers(void)
+// both flat and smooth shading disabled: (0, 0, 0, 1) normals, no shading effect.
+// smooth shading: the normal of each quad, read flat from its provoking vertex.
+// flat shading: normals from the center of the tube out to each vertex.
+TorusNormalMode currentNormalMode(void)
 {
-	// generate a vertex array object(VAO)
-	glGenVertexArrays(1, &torus_VAO);
-
-	// bind the VAO
-	glBindVertexArray(torus_VAO);
-
-	glGenBuffers(3, &torus_VBO[0]); //generate 3 buffers for data, their IDs are returned to the axis_VBO array
-
-	// first buffer: vertex coordinates
-	glBindBuffer(GL_ARRAY_BUFFER, torus_VBO[0]);
-	// allocate storage and copy vertex coordinates into the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(torusVertices[0]) * torusVertices.size(), &torusVertices[0], GL_STATIC_DRAW);
-	// specify the layout of the vertex data for the vertex shader
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	// enable the vertex attribute at index 0
-	glEnableVertexAttribArray(0);
-
-	// second buffer: colors
-	glBindBuffer(GL_ARRAY_BUFFER, torus_VBO[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(torusColors[0]) * torusColors.size(), &torusColors[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-
-	// new buffer for normals
-	glBindBuffer(GL_ARRAY_BUFFER, torus_VBO[2]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(normals[0]) * normals.size(), &normals[0], GL_STATIC_DRAW);
-	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(2);
-
-
-	glBindVertexArray(0); //unbind when done
+	if (flatShadingEnabled == false && smoothShadingEnabled == false)
+		return TORUS_NORMALS_NONE;
+	else if (smoothShadingEnabled == true)
+		return TORUS_NORMALS_FACE;
+	else
+		return TORUS_NORMALS_VERTEX;
 }
 
-
-
-void createNormLineBuffers(void)
+void CreateTorusBuffers(void)
 {
-	glGenVertexArrays(1, &normLines_VAO); //generate 1 new VAO, its ID is returned in axis_VAO
-	glBindVertexArray(normLines_VAO); //bind the VAO so the subsequent commands modify it
-
-	glGenBuffers(2, &normLines_VBO[0]); //generate 2 buffers for data, their IDs are returned to the axis_VBO array
-
-	// first buffer: vertex coordinates
-	glBindBuffer(GL_ARRAY_BUFFER, normLines_VBO[0]); //bind the first buffer using its ID
-	glBufferData(GL_ARRAY_BUFFER, sizeof(normLinesVertices[0]) * normLinesVertices.size(), &normLinesVertices[0], GL_STATIC_DRAW); //send coordinate array to the GPU
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0); //let GPU know this is attribute 0, made up of 4 floats
-	glEnableVertexAttribArray(0);
+	// the VAO and its buffers are only generated the first time, afterwards they are refilled in place
+	if (torus_Buffer.IsCreated() == false) {
+		torus_Buffer.Create(3);
+
+		// vec3 position, 10:10:10:2 normal and RGBA8 color interleaved into 20 bytes per vertex
+		torusFormat.Add(VERTEX_POSITION, 0, 3, GL_FLOAT);
+		torusFormat.Add(VERTEX_NORMAL, 2, 4, GL_INT_2_10_10_10_REV, GL_TRUE);
+		torusFormat.Add(VERTEX_COLOR, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+
+		// half float position (w = 1), octahedral 16-bit normal and RGBA8 color in 16 bytes per vertex
+		torusCompressedFormat.Add(VERTEX_POSITION, 0, 4, GL_HALF_FLOAT);
+		torusCompressedFormat.Add(VERTEX_OCTAHEDRAL_NORMAL, 2, 2, GL_SHORT, GL_TRUE);
+		torusCompressedFormat.Add(VERTEX_COLOR, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+	}
 
-	// second buffer: colors
-	glBindBuffer(GL_ARRAY_BUFFER, normLines_VBO[1]); //bind the second buffer using its ID
-	glBufferData(GL_ARRAY_BUFFER, sizeof(normLinesColors[0]) * normLinesColors.size(), &normLinesColors[0], GL_STATIC_DRAW); //send color array to the GPU
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0); //let GPU know this is attribute 1, made up of 4 floats
-	glEnableVertexAttribArray(1);
+	if (torusOnGPU == true) {
+		// the compute shader writes the float streams layout, whichever layout the CPU path uses
+		torus_Buffer.SetAttribute(0, 0, 4);
+		torus_Buffer.SetAttribute(1, 1, 4);
+		torus_Buffer.SetAttribute(2, 2, 4);
 
-	glBindVertexArray(0); //unbind when done
-}
+		torusTessellator.SetNormalMode(currentNormalMode());
+		torusTessellator.Generate(torus_Buffer, 0.0f, 0.0f, 0.0f, outerRad, innerRad, (int)Slices, (int)Loops);
+		return;
+	}
 
-//building lines from the torus vertices and normals
-void generateNormLines(std::vector<float> torusVertices, std::vector<float> normals) {
-	// clear previous lines
-	normLinesVertices.clear();
-	normLinesColors.clear();
-
-	// check for smooth or flat
-	if (smoothShadingEnabled) {
-		// in flat shading, normals are constant per face
-		for (int i = 0; i < torusVertices.size(); i += 12) {
-			// extract vertex position from the torus vertices
-			float vertexX = torusVertices[i];
-			float vertexY = torusVertices[i + 1];
-			float vertexZ = torusVertices[i + 2];
-
-			// calculate line end point by subtracting normal from vertex
-			// (accounting for potential inversion due to normal calculation)
-			float normalX = vertexX - normals[i];
-			float normalY = vertexY - normals[i + 1];
-			float normalZ = vertexZ - normals[i + 2];
-
-			// push vertex and line end point to normLinesVertices
-			normLinesVertices.push_back(vertexX);
-			normLinesVertices.push_back(vertexY);
-			normLinesVertices.push_back(vertexZ);
-			normLinesVertices.push_back(1.0f); // homogeneous point (w-component)
-
-			normLinesVertices.push_back(normalX);
-			normLinesVertices.push_back(normalY);
-			normLinesVertices.push_back(normalZ);
-			normLinesVertices.push_back(1.0f);
-
-			// set line color (red) for flat shading
-			for (int k = 0; k < 2; ++k) {
-				normLinesColors.push_back(1.0f);  // red
-				normLinesColors.push_back(0.0f);  
-				normLinesColors.push_back(0.0f);  
-				normLinesColors.push_back(1.0f);  
-			}
-		}
+	if (torusLayout != LAYOUT_FLOAT_STREAMS) {
+		const VertexFormat& format = (torusLayout == LAYOUT_COMPRESSED) ? torusCompressedFormat : torusFormat;
+		format.Pack(torus.GetVertices().data(), torus.GetColors().data(), torus.GetNormals().data(), torus.GetVertexCount(), torusPacked);
+		torus_Buffer.SetFormat(0, format);
+		torus_Buffer.SetData(0, torusPacked.data(), torusPacked.size());
 	}
-	else if (flatShadingEnabled) {
-		// in smooth shading, normals vary per vertex
-		for (int i = 0; i < torusVertices.size(); i += 12) {
-			// extract vertex position from torus vertices
-			float vertexX = torusVertices[i];
-			float vertexY = torusVertices[i + 1];
-			float vertexZ = torusVertices[i + 2];
-
-			// calculate line end point by adding normal to vertex
-			float normalX = vertexX + normals[i];
-			float normalY = vertexY + normals[i + 1];
-			float normalZ = vertexZ + normals[i + 2];
-
-			// push vertex and line end point to normLinesVertices
-			normLinesVertices.push_back(vertexX);
-			normLinesVertices.push_back(vertexY);
-			normLinesVertices.push_back(vertexZ);
-			normLinesVertices.push_back(1.0f); // homogeneous point (w-component)
-
-			normLinesVertices.push_back(normalX);
-			normLinesVertices.push_back(normalY);
-			normLinesVertices.push_back(normalZ);
-			normLinesVertices.push_back(1.0f);
-
-			// set line color (green) for smooth shading
-			for (int k = 0; k < 2; ++k) {
-				normLinesColors.push_back(0.0f);  
-				normLinesColors.push_back(1.0f);  // green
-				normLinesColors.push_back(0.0f);  
-				normLinesColors.push_back(1.0f);  
-			}
-		}
+	else {
+		// one buffer each for vertex coordinates, colors and normals, 4 floats per vertex (48 bytes)
+		torus_Buffer.SetAttribute(0, 0, 4);
+		torus_Buffer.SetAttribute(1, 1, 4);
+		torus_Buffer.SetAttribute(2, 2, 4);
+
+		torus_Buffer.SetData(0, torus.GetVertices().data(), sizeof(float) * torus.GetVertices().size());
+		torus_Buffer.SetData(1, torus.GetColors().data(), sizeof(float) * torus.GetColors().size());
+		torus_Buffer.SetData(2, torus.GetNormals().data(), sizeof(float) * torus.GetNormals().size());
 	}
+
+	// indices into the shared vertices, the VAO remembers this binding
+	torus_Buffer.SetIndexData(torus.GetIndexData(), torus.GetIndexDataSize());
 }
 
 
+
 // generate at specific coordinates
 void generateTorusAt(float centerX, float centerY, float centerZ, float rad1, float rad2, float slices, float loops) {
-	// set size counter and clear existing data
-	Size = 0;
-	torusVertices.clear();
-	torusColors.clear();
-	normals.clear();
-
-	// outer loop for vertical sections of the torus
-	for (int j = 0; j <= loops; ++j) {
-		float u1 = j / loops; //u1 representing the position along the loop section (from 0 to 1).
-		float loopAngle1 = u1 * 2.0f * 3.14f;  // converts u1 to an angle in radians, representing the rotation around the torus.
-		float cosLoops1 = cos(loopAngle1);  // computes the cosine of the rotation angle.	
-		float sinLoops1 = sin(loopAngle1); // computes the sine of the rotation angle.
-
-		float u2 = (j + 1) / loops; //u2 representing the position along the loop section (from 0 to 1) for the next vertex.
-		float loopAngle2 = u2 * 2.0f * 3.14f;
-		float cosLoops2 = cos(loopAngle2);
-		float sinLoops2 = sin(loopAngle2);
-
-		// loop for slices in each vertical section
-		for (int i = 0; i <= slices; ++i) {
-			float v1 = i / slices; // v1 representing the position along the slice (from 0 to 1).
-			float sliceAngle1 = v1 * 2.0f * 3.14f; // converts v1 to an angle in radians
-			float cosSlices1 = cos(sliceAngle1); // computes the cosine of the rotation angle within the slice.
-			float sinSlices1 = sin(sliceAngle1); // computes the sine of the rotation angle within the slice.
-			float sliceRadius1 = rad1 + rad2 * cosSlices1; // calculates the radius of the slice based on the major and minor radii.
-
-			float v2 = (i + 1) / slices; // v2 representing the position along the slice (from 0 to 1) for the next vertex.
-			float sliceAngle2 = v2 * 2.0f * 3.14f; // converts v2 to an angle in radians, representing the rotation around the slice for the next vertex.
-			float cosSlices2 = cos(sliceAngle2); // computes the cosine of the rotation angle within the slice for the next vertex.
-			float sinSlices2 = sin(sliceAngle2); // computes the sine of the rotation angle within the slice for the next vertex.
-			float sliceRadius2 = rad1 + rad2 * cosSlices2; // calculates the radius of the slice for the next vertex based on the major and minor radii.
-
-			float ax = sliceRadius1 * cosLoops1 + centerX;
-			float ay = sliceRadius1 * sinLoops1 + centerY;
-			float az = sinSlices1 * rad2 + centerZ;
-
-			float ax1 = sliceRadius1 * cosLoops2 + centerX;
-			float ay1 = sliceRadius1 * sinLoops2 + centerY;
-			float az1 = sinSlices1 * rad2 + centerZ;
-
-			float bx = sliceRadius2 * cosLoops1 + centerX;
-			float by = sliceRadius2 * sinLoops1 + centerY;
-			float bz = sinSlices2 * rad2 + centerZ;
-
-			float bx1 = sliceRadius2 * cosLoops2 + centerX;
-			float by1 = sliceRadius2 * sinLoops2 + centerY;
-			float bz1 = sinSlices2 * rad2 + centerZ;
-
-
-			// Calculate vectors for smooth shading
-			glm::vec3 vec_flat_1 = { bx - ax1, by - ay1, bz - az1 }; // calculates a vector in the plane of the torus slice from a1 to b.
-			glm::vec3 vec_flat_2 = { ax1 - ax, ay1 - ay, az1 - az }; // calculates a vector in the plane of the torus slice from a to a1.
-			glm::vec3 n1 = cross(vec_flat_1, vec_flat_2); // calculate normal for smooth shading
-			glm::vec3 n2 = normalize(n1); // normalize normal for smooth shading
-
-			// add the coordinates for vertex a
-			torusVertices.push_back(ax);
-			torusVertices.push_back(ay);
-			torusVertices.push_back(az);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex a.
-			Size++;
-
-			// add the coordinates for vertex a1.
-			torusVertices.push_back(ax1);
-			torusVertices.push_back(ay1);
-			torusVertices.push_back(az1);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex a1.
-			Size++;
-
-			// add the coordinates for vertex b.
-			torusVertices.push_back(bx);
-			torusVertices.push_back(by);
-			torusVertices.push_back(bz);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex b.
-			Size++;
-
-			// repeat coordinates to complete first triangle.
-			torusVertices.push_back(bx);
-			torusVertices.push_back(by);
-			torusVertices.push_back(bz);
-			torusVertices.push_back(1.0f);
-			Size++;
-
-			// repeat a1 to complete 2nd triangle.
-			torusVertices.push_back(ax1);
-			torusVertices.push_back(ay1);
-			torusVertices.push_back(az1);
-			torusVertices.push_back(1.0f);
-			Size++;
-
-			// add the coordinates for vertex b1.
-			torusVertices.push_back(bx1);
-			torusVertices.push_back(by1);
-			torusVertices.push_back(bz1);
-			torusVertices.push_back(1.0f); // homogeneous coordinate w for vertex b1.
-			Size++;
-
-			if (flatShadingEnabled == false && smoothShadingEnabled == false)
-				// both flat and smooth shading are disabled:
-				// set default normals for all vertices, no shading effect.
-				// each vertex has a normal of (0, 0, 0, 1), indicating no particular shading direction.
-			{
-				for (int l = 0; l < 6; l++)
-				{
-					normals.push_back(0.0f);
-					normals.push_back(0.0f);
-					normals.push_back(0.0f);
-					normals.push_back(1.0f);
-				}
-			}
-			else if (smoothShadingEnabled == true)
-			{
-				// smooth shading is enabled:
-				// set all normals for each vertex to the same value calculated for smooth shading.
-				// ensures a smooth transition of lighting across the surface.
-				for (int l = 0; l < 6; l++)
-				{
-					normals.push_back(n1[0]);
-					normals.push_back(n1[1]);
-					normals.push_back(n1[2]);
-					normals.push_back(1.0f);
-				}
-			}
-
+	torus.SetNormalMode(currentNormalMode());
+	torus.SetColor(1.0f, 0.5f, 0.0f, 1.0f);
+	torus.Generate(centerX, centerY, centerZ, rad1, rad2, (int)slices, (int)loops);
+}
 
+// generate the torus at the origin; only its shape parameters call for a rebuild
+void makeTorus(float rad1, float rad2, float slices, float loops) {
+	// on the GPU the torus is generated by CreateTorusBuffers, no CPU copy is needed
+	if (torusOnGPU == true)
+		return;
 
-			else if (flatShadingEnabled == true)
-				// flat shading is enabled:
-				// calculate normals for each triangle face and set them accordingly.
-				// shading effects where each face has its own constant shading.
-
-			{
-				// calculate normalized vector from center of torus to vertex a for flat shading
-				float norm_center_x1 = cosLoops1 * rad1;
-				float norm_center_y1 = sinLoops1 * rad1;
-
-				// calculate normalized vector from center of torus to vertex a1 for flat shading
-				float norm_center_x2 = cosLoops2 * rad1;
-				float norm_center_y2 = sinLoops2 * rad1;
-
-				// set normals for vertices a, a1, and b based on their positions relative to the center of the torus
-				normals.push_back(ax - norm_center_x1);
-				normals.push_back(ay - norm_center_y1);
-				normals.push_back(az);
-				normals.push_back(1.0f);
-
-				normals.push_back(ax1 - norm_center_x2);
-				normals.push_back(ay1 - norm_center_y2);
-				normals.push_back(az1);
-				normals.push_back(1.0f);
-
-				normals.push_back(bx - norm_center_x1);
-				normals.push_back(by - norm_center_y1);
-				normals.push_back(bz);
-				normals.push_back(1.0f);
-
-				normals.push_back(bx - norm_center_x1);
-				normals.push_back(by - norm_center_y1);
-				normals.push_back(bz);
-				normals.push_back(1.0f);
-
-				normals.push_back(ax1 - norm_center_x2);
-				normals.push_back(ay1 - norm_center_y2);
-				normals.push_back(az1);
-				normals.push_back(1.0f);
-
-				// set normals for vertex b1 based on its position relative to the center of the torus
-				normals.push_back(bx1 - norm_center_x2);
-				normals.push_back(by1 - norm_center_y2);
-				normals.push_back(bz1);
-				normals.push_back(1.0f);
-			}
+	generateTorusAt(0.0f, 0.0f, 0.0f, rad1, rad2, slices, loops);
+}
 
-			// run a color for each of our 6 points.
-			for (int k = 0; k < 6; ++k) {
-				torusColors.push_back(1);
-				torusColors.push_back(0.5);
-				torusColors.push_back(0);
-				torusColors.push_back(1);
-			}
-		
-		}
-	}
+// the torus is moved to its center by its object matrix, a translation, so the normals need no extra transform
+void UpdateTorusPlacement(void)
+{
+	TorusObjectMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(centerX, centerY, centerZ));
 }
 
 
@@ -528,9 +365,16 @@ void generateTorusAt(float centerX, float centerY, float centerZ, float rad1, fl
 // http://freeglut.sourceforge.net/docs/api.php#WindowCallback
 //-----------------------------------------------------------------------------
 
+// Rebuilds the matrices and draws one new frame once the pending events are handled
+void invalidate_transforms( void )
+{
+	transforms_dirty = true;
+	glutPostRedisplay();
+}
+
+// Only registered in continuous mode; otherwise frames are drawn on demand
 void idle_func()
 {
-	//uncomment below to repeatedly draw new frames
 	glutPostRedisplay();
 }
 
@@ -540,7 +384,7 @@ void reshape_func( int width, int height )
 	WindowHeight = height;
 
 	glViewport( 0, 0, width, height );
-	glutPostRedisplay();
+	invalidate_transforms();
 }
 
 void keyboard_func( unsigned char key, int x, int y )
@@ -557,9 +401,6 @@ void keyboard_func( unsigned char key, int x, int y )
 			else
 				std::cout << "Wireframes off.\n";
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers(); 
-
 			break;
 		}
 
@@ -567,12 +408,9 @@ void keyboard_func( unsigned char key, int x, int y )
 		{
 			Slices++;
 			Loops++;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			break;
 		}
 
@@ -581,71 +419,52 @@ void keyboard_func( unsigned char key, int x, int y )
 			Slices--;
 			Loops--;
 
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			break;
 		}
 
 		case 'w':
 		{
 			innerRad += 0.1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			break;
 		}
 
 		case 's':
 		{
 			innerRad -= 0.1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			break;
 		}
 
 		case 'e':
 		{
 			outerRad += 0.1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			break;
 		}
 
 		case 'd':
 		{
 			outerRad -= 0.1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			break;
 		}
 
 		case '1':
 		{
 			centerX += 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
-
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -653,11 +472,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '2':
 		{
 			centerX -= 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
-
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -665,11 +480,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '3':
 		{
 			centerY += 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
-
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -677,11 +488,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '4':
 		{
 			centerY -= 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
-
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -689,11 +496,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '5':
 		{
 			centerZ += 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
-
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -701,11 +504,7 @@ void keyboard_func( unsigned char key, int x, int y )
 		case '6':
 		{
 			centerZ -= 1;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
-			CreateTorusBuffers();
-
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
+			UpdateTorusPlacement();
 
 			break;
 		}
@@ -714,12 +513,9 @@ void keyboard_func( unsigned char key, int x, int y )
 		{
 			flatShadingEnabled = true;
 			smoothShadingEnabled = false;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			std::cout << "Finished flat shading\n\n";
 			break;
 		}
@@ -727,12 +523,9 @@ void keyboard_func( unsigned char key, int x, int y )
 		{
 			flatShadingEnabled = false;
 			smoothShadingEnabled = true;
-			generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+			makeTorus(outerRad, innerRad, Slices, Loops);
 			CreateTorusBuffers();
 
-			generateNormLines(torusVertices, normals);
-			createNormLineBuffers();
-
 			std::cout << "Finished smooth shading\n\n";
 			break;
 		}
@@ -744,13 +537,51 @@ void keyboard_func( unsigned char key, int x, int y )
 			break;
 		}
 
+		case 'v':
+		{
+			torusLayout = (torusLayout + 1) % 3;
+			CreateTorusBuffers();
+
+			if (torusLayout == LAYOUT_PACKED)
+				std::cout << "Packed interleaved vertices (" << torusFormat.GetStride() << " bytes).\n";
+			else if (torusLayout == LAYOUT_COMPRESSED)
+				std::cout << "Compressed interleaved vertices (" << torusCompressedFormat.GetStride() << " bytes).\n";
+			else
+				std::cout << "Separate float vertex streams (48 bytes).\n";
+			break;
+		}
+
+		case 't':
+		{
+			if (torusOnGPU == false && torusTessellator.IsCreated() == false) {
+				std::cout << "Compute shaders need OpenGL 4.3, the torus stays on the CPU.\n";
+				break;
+			}
+
+			torusOnGPU = !torusOnGPU;
+			makeTorus(outerRad, innerRad, Slices, Loops);
+			CreateTorusBuffers();
+
+			if (torusOnGPU == true)
+				std::cout << "Torus generated by a compute shader.\n";
+			else
+				std::cout << "Torus generated on the CPU.\n";
+			break;
+		}
+
 		// Exit on escape key press
 		case '\x1B':
 		{
 			exit( EXIT_SUCCESS );
 			break;
 		}
+
+		// Keys without a binding change nothing on screen
+		default:
+			return;
 	}
+
+	glutPostRedisplay();
 }
 
 void key_released( unsigned char key, int x, int y )
@@ -785,11 +616,16 @@ void mouse_func( int button, int state, int x, int y )
 	if( button == 3 )
 	{
 		perspZoom += 0.03f;
+		invalidate_transforms();
 	}
 	else if( button == 4 )
 	{
+		// At the zoom floor nothing changes, so nothing is redrawn
 		if( perspZoom - 0.03f > 0.0f )
+		{
 			perspZoom -= 0.03f;
+			invalidate_transforms();
+		}
 	}
 
 	mouse_states[ button ] = ( state == GLUT_DOWN );
@@ -822,6 +658,7 @@ void active_motion_func( int x, int y )
 	{
 		perspRotationY += ( x - LastMousePosX ) * perspSensitivity;
 		perspRotationX += ( y - LastMousePosY ) * perspSensitivity;
+		invalidate_transforms();
 	}
 
 	LastMousePosX = x;
@@ -835,20 +672,23 @@ void active_motion_func( int x, int y )
 =================================================================================================*/
 int numberOfObjects = 2;
 
-void display_func(void)
+// Draws one frame into the bound framebuffer: the window's back buffer, or the offscreen one when headless
+void render_scene(void)
 {
+	profiler.BeginFrame();
+
 	// Clear the contents of the back buffer
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Update transformation matrices
-	CreateTransformationMatrices();
+	// Update transformation matrices, only if an input changed them since the last frame
+	if( transforms_dirty == true )
+	{
+		CreateTransformationMatrices();
+		transforms_dirty = false;
+	}
 
-	// Use the perspective shader program
+	// Use the perspective shader program; the transformation matrices are already in the camera buffer
 	PerspectiveShader.Use();
-	PerspectiveShader.SetUniform("projectionMatrix", glm::value_ptr(PerspProjectionMatrix), 4, GL_FALSE, 1);
-	PerspectiveShader.SetUniform("viewMatrix", glm::value_ptr(PerspViewMatrix), 4, GL_FALSE, 1);
-	PerspectiveShader.SetUniform("modelMatrix", glm::value_ptr(PerspModelMatrix), 4, GL_FALSE, 1);
-	
 
 	// Drawing in wireframe?
 	if (draw_wireframe == true)
@@ -863,29 +703,71 @@ void display_func(void)
 		glShadeModel(GL_FLAT);
 
 	// Bind the axis Vertex Array Object created earlier and draw it
+	profiler.Begin("axis");
+	PerspectiveShader.SetUniform("objectMatrix", glm::value_ptr(glm::mat4(1.0f)), 4, GL_FALSE, 1);
 	glBindVertexArray(axis_VAO);
 	glDrawArrays(GL_LINES, 0, 6); // 6 = number of vertices in the object
-
-	//
-	glBindVertexArray(torus_VAO);
-	glDrawArrays(GL_TRIANGLES, 0, Size); // vertices appended based on size.
+	profiler.End();
+
+	// The torus is lit in view space with matrices prepared on the CPU
+	profiler.Begin("torus");
+	PerspLightShader.Use();
+	PerspLightShader.SetUniform("faceNormals", (GLint)smoothShadingEnabled);
+	PerspLightShader.SetUniform("normalEncoding", (GLint)(torusLayout == LAYOUT_COMPRESSED && torusOnGPU == false));
+	PerspLightShader.SetUniform("objectMatrix", glm::value_ptr(TorusObjectMatrix), 4, GL_FALSE, 1);
+
+	torus_Buffer.Bind();
+	if (torusOnGPU == true)
+		glDrawElements(GL_TRIANGLES, torusTessellator.GetIndexCount(), torusTessellator.GetIndexType(), (void*)0);
+	else
+		glDrawElements(GL_TRIANGLES, torus.GetIndexCount(), torus.GetIndexType(), (void*)0); // shared vertices, indexed per triangle
+	profiler.End();
 	//
 
 	// Unbind when done
 	glBindVertexArray(0);
 
-	if (showNormLines == true) {
-		glBindVertexArray(normLines_VAO);
-		glDrawArrays(GL_LINES, 0, Size); // vertices appended based on size.
+	if (showNormLines == true && (smoothShadingEnabled || flatShadingEnabled)) {
+		profiler.Begin("normal lines");
+
+		// face normals point inwards (accounting for the inversion due to normal calculation)
+		// so they are flipped and drawn red, vertex normals are drawn green as they are
+		NormalLinesShader.Use();
+		NormalLinesShader.SetUniform("normalEncoding", (GLint)(torusLayout == LAYOUT_COMPRESSED && torusOnGPU == false));
+		NormalLinesShader.SetUniform("objectMatrix", glm::value_ptr(TorusObjectMatrix), 4, GL_FALSE, 1);
+		NormalLinesShader.SetUniform("normalLength", smoothShadingEnabled ? -innerRad : innerRad);
+		if (smoothShadingEnabled)
+			NormalLinesShader.SetUniform("lineColor", 1.0f, 0.0f, 0.0f, 1.0f);
+		else
+			NormalLinesShader.SetUniform("lineColor", 0.0f, 1.0f, 0.0f, 1.0f);
+
+		// one point per shared vertex, the geometry shader turns each into a line
+		torus_Buffer.Bind();
+		glDrawArrays(GL_POINTS, 0, torusOnGPU ? torusTessellator.GetVertexCount() : torus.GetVertexCount());
 		glBindVertexArray(0);
+		profiler.End();
 	}
 
+	profiler.EndFrame();
+}
 
+void display_func(void)
+{
+	render_scene();
 
 	// Swap the front and back buffers
 	glutSwapBuffers();
 }
 
+// Headless mode moves the same orbit camera the mouse does
+void apply_camera_key( const CameraKey& key )
+{
+	perspRotationX = key.RotationX;
+	perspRotationY = key.RotationY;
+	perspZoom = key.Zoom;
+	transforms_dirty = true;
+}
+
 
 
 /*=================================================================================================
@@ -908,18 +790,29 @@ void init( void )
 	// Create shaders
 	CreateShaders();
 
+	// The compute tessellator needs GL 4.3; without it the torus is always generated on the CPU
+	if (torusTessellator.Create("./shaders/torus.comp") == true)
+		torusTessellator.SetColor(1.0f, 0.5f, 0.0f, 1.0f);
+	else if (torusOnGPU == true) {
+		std::cout << "Compute shaders need OpenGL 4.3, the torus stays on the CPU.\n\n";
+		torusOnGPU = false;
+	}
+
 	// Create axis buffers
 	CreateAxisBuffers();
 
 	//
-	generateTorusAt(centerX, centerY, centerZ, outerRad, innerRad, Slices, Loops);
+	makeTorus(outerRad, innerRad, Slices, Loops);
 	CreateTorusBuffers();
 
-	generateNormLines(torusVertices, normals);
-	createNormLineBuffers();
+	UpdateTorusPlacement();
 
 	//
 
+	// Timer queries need the context, so profiling is switched on here rather than in main
+	profiler.SetOutputFile( profiling_csv );
+	profiler.SetEnabled( profiling_enabled );
+
 	std::cout << "Finished initializing...\n\n";
 }
 
@@ -929,6 +822,39 @@ void init( void )
 
 int main( int argc, char** argv )
 {
+	// Viewer options; GLUT's own (-display, -geometry, ...) are left alone for glutInit
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[ i ], "--continuous" ) == 0 )
+			continuous_rendering = true;
+		else if( strcmp( argv[ i ], "--profile" ) == 0 )
+			profiling_enabled = true;
+		else if( strcmp( argv[ i ], "--profile-csv" ) == 0 && i + 1 < argc )
+		{
+			profiling_enabled = true;
+			profiling_csv = argv[ ++i ];
+		}
+		else if( strcmp( argv[ i ], "--gpu-torus" ) == 0 )
+			torusOnGPU = true;
+	}
+
+	// Without a window: render the frames, write them out and quit
+	if( headless.ParseArguments( argc, argv ) == true )
+	{
+		WindowWidth  = headless.GetWidth();
+		WindowHeight = headless.GetHeight();
+
+		if( headless.CreateContext( argc, argv ) == false )
+			return -1;
+
+		init();
+		int status = headless.Run( apply_camera_key, render_scene );
+
+		// Whatever is left since the last periodic report
+		profiler.Report();
+		return status;
+	}
+
 	// Create and initialize the OpenGL context
 	glutInit( &argc, argv );
 
@@ -948,7 +874,8 @@ int main( int argc, char** argv )
 
 	// Register callback functions
 	glutDisplayFunc( display_func );
-	glutIdleFunc( idle_func );
+	if( continuous_rendering == true )
+		glutIdleFunc( idle_func );
 	glutReshapeFunc( reshape_func );
 	glutKeyboardFunc( keyboard_func );
 	glutKeyboardUpFunc( key_released );
@@ -0,0 +1,27 @@
+#version 400
+
+layout(location=0) in vec4 in_Position;
+layout(location=2) in vec4 in_Normal;
+
+out vec3 vert_Normal;
+
+uniform int normalEncoding; // 0: xyz vector, 1: octahedral, folded into xy
+
+// Unfolds a normal stored as a point on the octahedron |x| + |y| + |z| = 1
+vec3 decodeOctahedral( vec2 e )
+{
+	vec3 n = vec3( e, 1.0 - abs( e.x ) - abs( e.y ) );
+	if( n.z < 0.0 )
+		n.xy = ( 1.0 - abs( n.yx ) ) * vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+	return normalize( n );
+}
+
+// Hands the vertex and its normal, both still in object space, to normals.geom
+void main(void)
+{
+	gl_Position = vec4( in_Position.xyz, 1.0 );
+
+	vert_Normal = in_Normal.xyz;
+	if( normalEncoding == 1 )
+		vert_Normal = decodeOctahedral( in_Normal.xy );
+}
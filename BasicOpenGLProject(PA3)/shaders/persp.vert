@@ -4,12 +4,22 @@ layout(location=0) in vec4 in_Position;
 layout(location=1) in vec4 in_Color;
 out vec4 vert_Color;
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
+// Filled once per frame by the application and shared by every program
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	mat4 modelMatrix;
+	mat4 modelViewMatrix;
+	mat4 normalMatrix;  // inverse transpose of the model-view matrix, in the upper 3x3
+	vec4 lightPosition; // in view space
+};
+
+// Places one object within the model, set before each draw
+uniform mat4 objectMatrix = mat4( 1.0 );
 
 void main(void)
 {
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4( in_Position.xyz, 1.0 );
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * objectMatrix * vec4( in_Position.xyz, 1.0 );
 	vert_Color = in_Color;
 }
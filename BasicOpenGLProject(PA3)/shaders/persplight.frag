@@ -3,11 +3,22 @@
 in vec4 vert_Pos;
 in vec4 vert_Color;
 in vec4 vert_Normal;
+flat in vec4 vert_FaceNormal;
 
 out vec4 frag_Color;
 
-uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
+// Filled once per frame by the application and shared by every program
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	mat4 modelMatrix;
+	mat4 modelViewMatrix;
+	mat4 normalMatrix;  // inverse transpose of the model-view matrix, in the upper 3x3
+	vec4 lightPosition; // in view space
+};
+
+uniform bool faceNormals; // read the provoking vertex's normal instead of interpolating
 
 vec4 shade( void )
 {
@@ -21,14 +32,12 @@ vec4 shade( void )
 
 	float shininess = 32.0f;
 
-	mat4 transf = viewMatrix * modelMatrix;
-
-	vec3 FragPos  = vec3( transf * vert_Pos );
-	vec3 FragNorm = mat3( transpose( inverse( transf ) ) ) * vert_Normal.xyz;
-	vec3 LightPos = vec3( transf * vec4( 3.0, 0.0, 3.0, 1.0 ) );
+	// Position and normals arrive in view space already
+	vec3 FragPos  = vert_Pos.xyz;
+	vec3 FragNorm = faceNormals ? vert_FaceNormal.xyz : vert_Normal.xyz;
 
 	vec3 N = normalize( FragNorm ); // vertex normal
-	vec3 L = normalize( LightPos - FragPos ); // light direction
+	vec3 L = normalize( lightPosition.xyz - FragPos ); // light direction
 	vec3 R = normalize( reflect( -L, N ) ); // reflected ray
 	vec3 V = normalize( vec3( 0.0, 0.0, 1.0 ) ); // view direction
 
@@ -7,16 +7,47 @@ layout(location=2) in vec4 in_Normal;
 out vec4 vert_Pos;
 out vec4 vert_Color;
 out vec4 vert_Normal;
+flat out vec4 vert_FaceNormal;
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
+// Filled once per frame by the application and shared by every program
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	mat4 modelMatrix;
+	mat4 modelViewMatrix;
+	mat4 normalMatrix;  // inverse transpose of the model-view matrix, in the upper 3x3
+	vec4 lightPosition; // in view space
+};
+
+uniform int normalEncoding; // 0: xyz vector, 1: octahedral, folded into xy
+
+// Places the torus within the model; a translation, so normalMatrix still applies to the normals
+uniform mat4 objectMatrix = mat4( 1.0 );
+
+// Unfolds a normal stored as a point on the octahedron |x| + |y| + |z| = 1
+vec3 decodeOctahedral( vec2 e )
+{
+	vec3 n = vec3( e, 1.0 - abs( e.x ) - abs( e.y ) );
+	if( n.z < 0.0 )
+		n.xy = ( 1.0 - abs( n.yx ) ) * vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+	return normalize( n );
+}
 
 void main(void)
 {
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4( in_Position.xyz, 1.0 );
-	
-	vert_Pos    = in_Position;
+	vec4 viewPos = modelViewMatrix * objectMatrix * vec4( in_Position.xyz, 1.0 );
+	gl_Position = projectionMatrix * viewPos;
+
+	// Lighting happens in view space; both transforms are linear, so interpolating afterwards is exact
+	vert_Pos    = viewPos;
 	vert_Color  = in_Color;
-	vert_Normal = in_Normal;
+	vec4 normal = in_Normal;
+	if( normalEncoding == 1 )
+		normal = vec4( decodeOctahedral( in_Normal.xy ), 1.0 );
+
+	normal = vec4( mat3( normalMatrix ) * normal.xyz, 0.0 );
+
+	vert_Normal = normal;
+	vert_FaceNormal = normal;
 }
@@ -0,0 +1,515 @@
+#include "torus.h"
+#include <cmath>
+#include <thread>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+#define TORUS_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX instructions in functions that ask for them; MSVC always can
+#if defined( TORUS_SIMD_X86 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define TORUS_TARGET_AVX __attribute__(( target( "avx" ) ))
+#else
+#define TORUS_TARGET_AVX
+#endif
+
+static const float TWO_PI = 6.28318530718f;
+
+// Below this many vertices per worker, starting a thread costs more than it saves
+static const int MIN_VERTICES_PER_THREAD = 32768;
+
+// Fills cosines and sines for steps + 2 evenly spaced angles. The entry at steps wraps to
+// angle 0 so the seam closes exactly, and the one past it lets a quad look one step ahead.
+static void fillRing( std::vector<float>& cosines, std::vector<float>& sines, int steps )
+{
+	cosines.resize( steps + 2 );
+	sines.resize( steps + 2 );
+
+	for( int k = 0; k <= steps + 1; k++ )
+	{
+		float angle = TWO_PI * ( k % steps ) / steps;
+		cosines[ k ] = cosf( angle );
+		sines[ k ]   = sinf( angle );
+	}
+}
+
+/*=================================================================================================
+  ROW KERNELS
+=================================================================================================*/
+
+// Everything needed to fill one row of the grid (one loop step, every slice)
+struct TorusRow
+{
+	const float* sliceCos;
+	const float* sliceSin;
+	float cu, su;         // loop angle of this row
+	float cuNext, suNext; // loop angle of the next row, for face normals
+	float rad1, rad2;
+	const float* center;
+	const float* color;
+	TorusNormalMode normalMode;
+
+	float* vertices;
+	float* colors;
+	float* normals;
+};
+
+// Fills slices [first, last) of the row one vertex at a time
+static void fillRowScalar( const TorusRow& row, int first, int last )
+{
+	const float rad1 = row.rad1;
+	const float rad2 = row.rad2;
+
+	for( int i = first; i < last; i++ )
+	{
+		float sliceRadius = rad1 + rad2 * row.sliceCos[ i ];
+		float a[3] = { sliceRadius * row.cu, sliceRadius * row.su, rad2 * row.sliceSin[ i ] };
+
+		float* vertex = row.vertices + 4 * i;
+		vertex[0] = a[0] + row.center[0];
+		vertex[1] = a[1] + row.center[1];
+		vertex[2] = a[2] + row.center[2];
+		vertex[3] = 1.0f;
+
+		float* color = row.colors + 4 * i;
+		color[0] = row.color[0];
+		color[1] = row.color[1];
+		color[2] = row.color[2];
+		color[3] = row.color[3];
+
+		float n[3] = { 0.0f, 0.0f, 0.0f };
+
+		if( row.normalMode == TORUS_NORMALS_VERTEX )
+		{
+			// Subtracting the tube's center line leaves the outward direction
+			n[0] = a[0] - rad1 * row.cu;
+			n[1] = a[1] - rad1 * row.su;
+			n[2] = a[2];
+		}
+		else if( row.normalMode == TORUS_NORMALS_FACE )
+		{
+			// Quad (i, j) spans a = (i, j), a1 = (i, j+1) and b = (i+1, j)
+			float a1[3] = { sliceRadius * row.cuNext, sliceRadius * row.suNext, a[2] };
+
+			float nextRadius = rad1 + rad2 * row.sliceCos[ i + 1 ];
+			float b[3] = { nextRadius * row.cu, nextRadius * row.su, rad2 * row.sliceSin[ i + 1 ] };
+
+			float e1[3] = { b[0] - a1[0], b[1] - a1[1], b[2] - a1[2] };
+			float e2[3] = { a1[0] - a[0], a1[1] - a[1], a1[2] - a[2] };
+
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		}
+
+		float* normal = row.normals + 4 * i;
+		normal[0] = n[0];
+		normal[1] = n[1];
+		normal[2] = n[2];
+		normal[3] = 1.0f;
+	}
+}
+
+#ifdef TORUS_SIMD_X86
+
+// Four slices per step with SSE2: the same operations as the scalar path in the same order,
+// so both produce identical floats. Returns the first slice it did not fill.
+static int fillRowSSE2( const TorusRow& row, int count )
+{
+	const __m128 rad1 = _mm_set1_ps( row.rad1 );
+	const __m128 rad2 = _mm_set1_ps( row.rad2 );
+	const __m128 cu = _mm_set1_ps( row.cu );
+	const __m128 su = _mm_set1_ps( row.su );
+	const __m128 cuNext = _mm_set1_ps( row.cuNext );
+	const __m128 suNext = _mm_set1_ps( row.suNext );
+	const __m128 cx = _mm_set1_ps( row.center[0] );
+	const __m128 cy = _mm_set1_ps( row.center[1] );
+	const __m128 cz = _mm_set1_ps( row.center[2] );
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 color = _mm_loadu_ps( row.color );
+
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 cv = _mm_loadu_ps( row.sliceCos + i );
+		__m128 sv = _mm_loadu_ps( row.sliceSin + i );
+
+		__m128 sliceRadius = _mm_add_ps( rad1, _mm_mul_ps( rad2, cv ) );
+		__m128 ax = _mm_mul_ps( sliceRadius, cu );
+		__m128 ay = _mm_mul_ps( sliceRadius, su );
+		__m128 az = _mm_mul_ps( rad2, sv );
+
+		__m128 x = _mm_add_ps( ax, cx );
+		__m128 y = _mm_add_ps( ay, cy );
+		__m128 z = _mm_add_ps( az, cz );
+		__m128 w = one;
+		_MM_TRANSPOSE4_PS( x, y, z, w );
+		_mm_storeu_ps( row.vertices + 4 * i,      x );
+		_mm_storeu_ps( row.vertices + 4 * i + 4,  y );
+		_mm_storeu_ps( row.vertices + 4 * i + 8,  z );
+		_mm_storeu_ps( row.vertices + 4 * i + 12, w );
+
+		for( int k = 0; k < 4; k++ )
+			_mm_storeu_ps( row.colors + 4 * ( i + k ), color );
+
+		__m128 nx = _mm_setzero_ps();
+		__m128 ny = _mm_setzero_ps();
+		__m128 nz = _mm_setzero_ps();
+
+		if( row.normalMode == TORUS_NORMALS_VERTEX )
+		{
+			nx = _mm_sub_ps( ax, _mm_mul_ps( rad1, cu ) );
+			ny = _mm_sub_ps( ay, _mm_mul_ps( rad1, su ) );
+			nz = az;
+		}
+		else if( row.normalMode == TORUS_NORMALS_FACE )
+		{
+			__m128 a1x = _mm_mul_ps( sliceRadius, cuNext );
+			__m128 a1y = _mm_mul_ps( sliceRadius, suNext );
+
+			__m128 nextRadius = _mm_add_ps( rad1, _mm_mul_ps( rad2, _mm_loadu_ps( row.sliceCos + i + 1 ) ) );
+			__m128 bx = _mm_mul_ps( nextRadius, cu );
+			__m128 by = _mm_mul_ps( nextRadius, su );
+			__m128 bz = _mm_mul_ps( rad2, _mm_loadu_ps( row.sliceSin + i + 1 ) );
+
+			__m128 e1x = _mm_sub_ps( bx, a1x ), e1y = _mm_sub_ps( by, a1y ), e1z = _mm_sub_ps( bz, az );
+			__m128 e2x = _mm_sub_ps( a1x, ax ), e2y = _mm_sub_ps( a1y, ay ), e2z = _mm_sub_ps( az, az );
+
+			nx = _mm_sub_ps( _mm_mul_ps( e1y, e2z ), _mm_mul_ps( e1z, e2y ) );
+			ny = _mm_sub_ps( _mm_mul_ps( e1z, e2x ), _mm_mul_ps( e1x, e2z ) );
+			nz = _mm_sub_ps( _mm_mul_ps( e1x, e2y ), _mm_mul_ps( e1y, e2x ) );
+		}
+
+		__m128 nw = one;
+		_MM_TRANSPOSE4_PS( nx, ny, nz, nw );
+		_mm_storeu_ps( row.normals + 4 * i,      nx );
+		_mm_storeu_ps( row.normals + 4 * i + 4,  ny );
+		_mm_storeu_ps( row.normals + 4 * i + 8,  nz );
+		_mm_storeu_ps( row.normals + 4 * i + 12, nw );
+	}
+
+	return i;
+}
+
+// Interleaves eight x, y, z, w lanes into eight consecutive xyzw vertices
+TORUS_TARGET_AVX static void storeVerticesAVX( float* out, __m256 x, __m256 y, __m256 z, __m256 w )
+{
+	__m256 xy0 = _mm256_unpacklo_ps( x, y ); // x0 y0 x1 y1 | x4 y4 x5 y5
+	__m256 xy1 = _mm256_unpackhi_ps( x, y ); // x2 y2 x3 y3 | x6 y6 x7 y7
+	__m256 zw0 = _mm256_unpacklo_ps( z, w );
+	__m256 zw1 = _mm256_unpackhi_ps( z, w );
+
+	__m256 v04 = _mm256_shuffle_ps( xy0, zw0, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	__m256 v15 = _mm256_shuffle_ps( xy0, zw0, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+	__m256 v26 = _mm256_shuffle_ps( xy1, zw1, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+	__m256 v37 = _mm256_shuffle_ps( xy1, zw1, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+
+	_mm256_storeu_ps( out,      _mm256_permute2f128_ps( v04, v15, 0x20 ) );
+	_mm256_storeu_ps( out + 8,  _mm256_permute2f128_ps( v26, v37, 0x20 ) );
+	_mm256_storeu_ps( out + 16, _mm256_permute2f128_ps( v04, v15, 0x31 ) );
+	_mm256_storeu_ps( out + 24, _mm256_permute2f128_ps( v26, v37, 0x31 ) );
+}
+
+// Eight slices per step with AVX, otherwise the same as fillRowSSE2
+TORUS_TARGET_AVX static int fillRowAVX( const TorusRow& row, int count )
+{
+	const __m256 rad1 = _mm256_set1_ps( row.rad1 );
+	const __m256 rad2 = _mm256_set1_ps( row.rad2 );
+	const __m256 cu = _mm256_set1_ps( row.cu );
+	const __m256 su = _mm256_set1_ps( row.su );
+	const __m256 cuNext = _mm256_set1_ps( row.cuNext );
+	const __m256 suNext = _mm256_set1_ps( row.suNext );
+	const __m256 cx = _mm256_set1_ps( row.center[0] );
+	const __m256 cy = _mm256_set1_ps( row.center[1] );
+	const __m256 cz = _mm256_set1_ps( row.center[2] );
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps( 1.0f );
+	const __m256 color = _mm256_broadcast_ps( (const __m128*)row.color );
+
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256 cv = _mm256_loadu_ps( row.sliceCos + i );
+		__m256 sv = _mm256_loadu_ps( row.sliceSin + i );
+
+		__m256 sliceRadius = _mm256_add_ps( rad1, _mm256_mul_ps( rad2, cv ) );
+		__m256 ax = _mm256_mul_ps( sliceRadius, cu );
+		__m256 ay = _mm256_mul_ps( sliceRadius, su );
+		__m256 az = _mm256_mul_ps( rad2, sv );
+
+		storeVerticesAVX( row.vertices + 4 * i, _mm256_add_ps( ax, cx ), _mm256_add_ps( ay, cy ), _mm256_add_ps( az, cz ), one );
+
+		for( int k = 0; k < 8; k += 2 )
+			_mm256_storeu_ps( row.colors + 4 * ( i + k ), color );
+
+		__m256 nx = zero;
+		__m256 ny = zero;
+		__m256 nz = zero;
+
+		if( row.normalMode == TORUS_NORMALS_VERTEX )
+		{
+			nx = _mm256_sub_ps( ax, _mm256_mul_ps( rad1, cu ) );
+			ny = _mm256_sub_ps( ay, _mm256_mul_ps( rad1, su ) );
+			nz = az;
+		}
+		else if( row.normalMode == TORUS_NORMALS_FACE )
+		{
+			__m256 a1x = _mm256_mul_ps( sliceRadius, cuNext );
+			__m256 a1y = _mm256_mul_ps( sliceRadius, suNext );
+
+			__m256 nextRadius = _mm256_add_ps( rad1, _mm256_mul_ps( rad2, _mm256_loadu_ps( row.sliceCos + i + 1 ) ) );
+			__m256 bx = _mm256_mul_ps( nextRadius, cu );
+			__m256 by = _mm256_mul_ps( nextRadius, su );
+			__m256 bz = _mm256_mul_ps( rad2, _mm256_loadu_ps( row.sliceSin + i + 1 ) );
+
+			__m256 e1x = _mm256_sub_ps( bx, a1x ), e1y = _mm256_sub_ps( by, a1y ), e1z = _mm256_sub_ps( bz, az );
+			__m256 e2x = _mm256_sub_ps( a1x, ax ), e2y = _mm256_sub_ps( a1y, ay ), e2z = _mm256_sub_ps( az, az );
+
+			nx = _mm256_sub_ps( _mm256_mul_ps( e1y, e2z ), _mm256_mul_ps( e1z, e2y ) );
+			ny = _mm256_sub_ps( _mm256_mul_ps( e1z, e2x ), _mm256_mul_ps( e1x, e2z ) );
+			nz = _mm256_sub_ps( _mm256_mul_ps( e1x, e2y ), _mm256_mul_ps( e1y, e2x ) );
+		}
+
+		storeVerticesAVX( row.normals + 4 * i, nx, ny, nz, one );
+	}
+
+	// Leave AVX state clean before the SSE or scalar code that follows
+	_mm256_zeroupper();
+	return i;
+}
+
+static bool cpuSupportsAVX()
+{
+#if defined( _MSC_VER )
+	// CPUID.1:ECX bit 28 is AVX, bit 27 says the OS uses XSAVE; XCR0 bits 1-2 say it saves YMM state
+	int info[4];
+	__cpuid( info, 1 );
+
+	if( ( info[2] & ( 1 << 27 ) ) == 0 || ( info[2] & ( 1 << 28 ) ) == 0 )
+		return false;
+
+	return ( _xgetbv( 0 ) & 0x6 ) == 0x6;
+#else
+	return __builtin_cpu_supports( "avx" ) != 0;
+#endif
+}
+
+#endif // TORUS_SIMD_X86
+
+typedef int ( *RowKernel )( const TorusRow& row, int count );
+
+// Picks the widest kernel this CPU runs, once; NULL leaves every slice to the scalar path
+static RowKernel selectRowKernel()
+{
+#ifdef TORUS_SIMD_X86
+	if( cpuSupportsAVX() == true )
+		return fillRowAVX;
+
+	return fillRowSSE2;
+#else
+	return NULL;
+#endif
+}
+
+static void fillRow( const TorusRow& row, int count )
+{
+	static const RowKernel kernel = selectRowKernel();
+
+	int filled = ( kernel != NULL ) ? kernel( row, count ) : 0;
+	fillRowScalar( row, filled, count );
+}
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+TorusMesh::TorusMesh()
+{
+	SetColor( 1.0f, 1.0f, 1.0f, 1.0f );
+	NormalMode = TORUS_NORMALS_VERTEX;
+	ThreadCount = 0;
+
+	Center[0] = Center[1] = Center[2] = 0.0f;
+	MajorRadius = MinorRadius = 0.0f;
+	Slices = Loops = 0;
+}
+
+/*=================================================================================================
+  GENERATE
+=================================================================================================*/
+
+void TorusMesh::Generate( float centerX, float centerY, float centerZ, float rad1, float rad2, int slices, int loops )
+{
+	if( slices < 1 || loops < 1 )
+	{
+		Clear();
+		return;
+	}
+
+	Center[0] = centerX;
+	Center[1] = centerY;
+	Center[2] = centerZ;
+	MajorRadius = rad1;
+	MinorRadius = rad2;
+	Slices = slices;
+	Loops = loops;
+
+	const int numRows = loops + 1;
+	const int numVertices = ( slices + 1 ) * numRows;
+	const int numIndices = slices * loops * 6;
+
+	// Exact sizes up front; regenerating at the same resolution touches no allocator at all
+	Vertices.resize( numVertices * 4 );
+	Colors.resize( numVertices * 4 );
+	Normals.resize( numVertices * 4 );
+
+	if( numVertices <= 65536 )
+	{
+		Indices16.resize( numIndices );
+		Indices32.clear();
+	}
+	else
+	{
+		Indices32.resize( numIndices );
+		Indices16.clear();
+	}
+
+	// Every trig value the grid needs: loops + slices calls instead of several per vertex
+	fillRing( LoopCos, LoopSin, loops );
+	fillRing( SliceCos, SliceSin, slices );
+
+	// Rows are independent, so each worker fills its own contiguous block of them
+	int numThreads = ThreadCount > 0 ? ThreadCount : (int)std::thread::hardware_concurrency();
+	int maxThreads = numVertices / MIN_VERTICES_PER_THREAD;
+
+	if( numThreads > maxThreads )
+		numThreads = maxThreads;
+	if( numThreads > numRows )
+		numThreads = numRows;
+
+	if( numThreads <= 1 )
+	{
+		generateRows( 0, numRows );
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve( numThreads - 1 );
+
+	for( int t = 1; t < numThreads; t++ )
+		workers.emplace_back( &TorusMesh::generateRows, this, t * numRows / numThreads, ( t + 1 ) * numRows / numThreads );
+
+	generateRows( 0, numRows / numThreads );
+
+	for( size_t t = 0; t < workers.size(); t++ )
+		workers[ t ].join();
+}
+
+// Indices of the quads starting on row j; both triangles end on the quad's first corner (the provoking vertex)
+template<typename Index>
+static void writeQuadRow( Index* out, int j, int slices )
+{
+	const int rowLength = slices + 1;
+
+	for( int i = 0; i < slices; i++ )
+	{
+		Index a  = (Index)( j * rowLength + i );
+		Index b  = a + 1;
+		Index a1 = (Index)( a + rowLength );
+		Index b1 = a1 + 1;
+
+		out[0] = a1; out[1] = b1; out[2] = a;
+		out[3] = b1; out[4] = b;  out[5] = a;
+		out += 6;
+	}
+}
+
+void TorusMesh::generateRows( int firstRow, int lastRow )
+{
+	const int slices = Slices;
+	const int rowLength = slices + 1;
+
+	TorusRow row;
+	row.sliceCos = SliceCos.data();
+	row.sliceSin = SliceSin.data();
+	row.rad1 = MajorRadius;
+	row.rad2 = MinorRadius;
+	row.center = Center;
+	row.color = Color;
+	row.normalMode = NormalMode;
+
+	// Vertex (i, j) sits at slice i of loop j
+	for( int j = firstRow; j < lastRow; j++ )
+	{
+		row.cu = LoopCos[ j ];
+		row.su = LoopSin[ j ];
+		row.cuNext = LoopCos[ j + 1 ];
+		row.suNext = LoopSin[ j + 1 ];
+
+		row.vertices = &Vertices[ j * rowLength * 4 ];
+		row.colors   = &Colors[ j * rowLength * 4 ];
+		row.normals  = &Normals[ j * rowLength * 4 ];
+
+		fillRow( row, rowLength );
+
+		// The last row only closes the seam, no quads start on it
+		if( j < Loops )
+		{
+			if( Indices32.empty() == true )
+				writeQuadRow( &Indices16[ j * slices * 6 ], j, slices );
+			else
+				writeQuadRow( &Indices32[ j * slices * 6 ], j, slices );
+		}
+	}
+}
+
+void TorusMesh::Clear( void )
+{
+	Vertices.clear();
+	Colors.clear();
+	Normals.clear();
+	Indices16.clear();
+	Indices32.clear();
+}
+
+void TorusMesh::SetColor( float r, float g, float b, float a )
+{
+	Color[0] = r;
+	Color[1] = g;
+	Color[2] = b;
+	Color[3] = a;
+}
+
+/*=================================================================================================
+  INDICES
+=================================================================================================*/
+
+GLsizei TorusMesh::GetIndexCount( void ) const
+{
+	return (GLsizei)( Indices16.empty() ? Indices32.size() : Indices16.size() );
+}
+
+GLenum TorusMesh::GetIndexType( void ) const
+{
+	return Indices32.empty() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+const void* TorusMesh::GetIndexData( void ) const
+{
+	if( Indices32.empty() == false )
+		return Indices32.data();
+
+	return Indices16.data();
+}
+
+GLsizeiptr TorusMesh::GetIndexDataSize( void ) const
+{
+	if( Indices32.empty() == false )
+		return Indices32.size() * sizeof( GLuint );
+
+	return Indices16.size() * sizeof( GLushort );
+}
@@ -0,0 +1,87 @@
+#include "torustessellator.h"
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+TorusTessellator::TorusTessellator()
+{
+	Created = false;
+	SetColor( 1.0f, 1.0f, 1.0f, 1.0f );
+	NormalMode = TORUS_NORMALS_VERTEX;
+	VertexCount = 0;
+	IndexCount = 0;
+}
+
+/*=================================================================================================
+  SETTINGS
+=================================================================================================*/
+
+bool TorusTessellator::Create( std::string cspath )
+{
+	if( Created == true )
+		return true;
+
+	if( GLEW_VERSION_4_3 == false )
+		return false;
+
+	Program.Create( cspath );
+	Created = ( Program.GetLinkStatus() == GL_TRUE );
+
+	return Created;
+}
+
+void TorusTessellator::SetColor( float r, float g, float b, float a )
+{
+	Color[0] = r;
+	Color[1] = g;
+	Color[2] = b;
+	Color[3] = a;
+}
+
+/*=================================================================================================
+  GENERATE
+=================================================================================================*/
+
+void TorusTessellator::Generate( MeshBuffer& mesh, float centerX, float centerY, float centerZ, float rad1, float rad2, int slices, int loops )
+{
+	if( Created == false || slices < 1 || loops < 1 )
+	{
+		VertexCount = IndexCount = 0;
+		return;
+	}
+
+	const int rowLength = slices + 1;
+	VertexCount = rowLength * ( loops + 1 );
+	IndexCount = slices * loops * 6;
+
+	// Storage only: passing no data allocates (or orphans) without a copy, the shader writes every byte
+	GLsizeiptr streamSize = sizeof( float ) * 4 * VertexCount;
+	mesh.SetData( 0, NULL, streamSize );
+	mesh.SetData( 1, NULL, streamSize );
+	mesh.SetData( 2, NULL, streamSize );
+	mesh.SetIndexData( NULL, sizeof( GLuint ) * IndexCount );
+
+	Program.Use();
+	Program.SetUniform( "center", centerX, centerY, centerZ );
+	Program.SetUniform( "rad1", rad1 );
+	Program.SetUniform( "rad2", rad2 );
+	Program.SetUniform( "slices", (GLint)slices );
+	Program.SetUniform( "loops", (GLint)loops );
+	Program.SetUniform( "normalMode", (GLint)NormalMode );
+	Program.SetUniform( "color", Color[0], Color[1], Color[2], Color[3] );
+
+	// The binding points are the layout(binding) qualifiers of torus.comp
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, mesh.GetBufferID( 0 ) );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, mesh.GetBufferID( 1 ) );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 2, mesh.GetBufferID( 2 ) );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 3, mesh.GetIndexBufferID() );
+
+	// One invocation per vertex: x runs along a row (the slices), y over the rows (the loops)
+	glDispatchCompute( ( rowLength + LocalSize - 1 ) / LocalSize, loops + 1, 1 );
+
+	// Draws that follow read the results as vertex attributes and indices
+	glMemoryBarrier( GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT );
+
+	glUseProgram( 0 );
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include "meshbuffer.h"
+#include "shaderprogram.h"
+#include "torus.h"
+
+/**
+Builds the torus of TorusMesh::Generate with a compute shader, straight into the storage of a MeshBuffer:
+positions, colors and normals as 4 floats per vertex in vertex buffers 0, 1 and 2 (the float streams
+layout) and 32-bit triangle indices in the element buffer. No vertex is computed or copied on the CPU.
+Needs OpenGL 4.3 for compute shaders and shader storage buffers.
+**/
+class TorusTessellator
+{
+public:
+	TorusTessellator();
+
+public:
+	/**
+	Builds the compute program. Returns false, leaving the tessellator unusable, when the context
+	lacks OpenGL 4.3 or the shader fails to build.
+	*@param cspath Path of torus.comp.
+	**/
+	bool Create( std::string cspath );
+
+	bool IsCreated() const { return Created; }
+
+	void SetColor( float r, float g, float b, float a );
+	void SetNormalMode( TorusNormalMode mode ) { NormalMode = mode; }
+
+	/**
+	Sizes the buffers of the mesh (which needs at least 3 vertex buffers) and fills them on the GPU,
+	then issues the barrier that makes the writes visible to vertex fetching and indexed draws.
+	Same parameters as TorusMesh::Generate.
+	**/
+	void Generate( MeshBuffer& mesh, float centerX, float centerY, float centerZ, float rad1, float rad2, int slices, int loops );
+
+public:
+	GLsizei GetVertexCount() const { return VertexCount; }
+	GLsizei GetIndexCount()  const { return IndexCount; }
+	GLenum  GetIndexType()   const { return GL_UNSIGNED_INT; }
+
+private:
+	// Must match local_size_x in torus.comp
+	static const int LocalSize = 64;
+
+	TorusTessellator( const TorusTessellator& ) = delete;
+	TorusTessellator& operator=( const TorusTessellator& ) = delete;
+
+private:
+	ShaderProgram Program;
+	bool Created;
+
+	float Color[4];
+	TorusNormalMode NormalMode;
+
+	GLsizei VertexCount;
+	GLsizei IndexCount;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/**
+A uniform buffer attached to a fixed binding point. Every program whose uniform block is bound to
+the same point (ShaderProgram::SetUniformBlockBinding) reads from it, so values shared by all
+programs are uploaded once instead of once per program.
+**/
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+public:
+	/**
+	Generates the buffer, allocates its storage and attaches it to a binding point. Does nothing if already created.
+	*@param binding Uniform buffer binding point.
+	*@param size Size of the block in bytes (std140 layout).
+	*@param usage Usage hint for the storage.
+	**/
+	void Create( GLuint binding, GLsizeiptr size, GLenum usage = GL_DYNAMIC_DRAW );
+	void Delete();
+
+	bool IsCreated() const { return ID != 0; }
+
+	/**
+	Replaces the whole block. The storage is orphaned first, so draws still reading last frame's values don't stall the upload.
+	**/
+	void SetData( const void* data );
+
+	/**
+	Overwrites a byte range of the block in place; the range must lie within the block.
+	**/
+	void UpdateData( GLintptr offset, const void* data, GLsizeiptr size );
+
+public:
+	GLuint GetID() const { return ID; }
+	GLuint GetBinding() const { return Binding; }
+	GLsizeiptr GetSize() const { return Size; }
+
+private:
+	UniformBuffer( const UniformBuffer& ) = delete;
+	UniformBuffer& operator=( const UniformBuffer& ) = delete;
+
+private:
+	GLuint ID;
+	GLuint Binding;
+	GLsizeiptr Size;
+	GLenum Usage;
+};
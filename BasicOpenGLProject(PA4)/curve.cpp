@@ -0,0 +1,560 @@
+#include "curve.h"
+#include <algorithm>
+#include <math.h>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+Curve::Curve()
+{
+	SetColor( 1.0f, 1.0f, 1.0f, 1.0f );
+	Method = BEZIER_AUTO;
+
+	Degree = 2;
+	BasisCacheValid = false;
+	BasisCacheSteps = 0;
+	BSplineSampled = false;
+}
+
+/*=================================================================================================
+  SETTINGS
+=================================================================================================*/
+
+void Curve::SetControlPoints( const float* points, int count )
+{
+	// The default knots, and so the basis, depend on the number of points
+	if( count != GetControlPointCount() )
+		BasisCacheValid = false;
+
+	// The samples are of the old points now
+	BSplineSampled = false;
+
+	ControlPoints.assign( points, points + 4 * count );
+}
+
+void Curve::SetKnots( const std::vector<float>& knots )
+{
+	if( knots != Knots )
+		BasisCacheValid = false;
+
+	Knots = knots;
+}
+
+void Curve::SetDegree( int degree )
+{
+	if( degree < 1 )
+		degree = 1;
+
+	if( degree != Degree )
+		BasisCacheValid = false;
+
+	Degree = degree;
+}
+
+void Curve::SetColor( float r, float g, float b, float a )
+{
+	Color[0] = r;
+	Color[1] = g;
+	Color[2] = b;
+	Color[3] = a;
+}
+
+void Curve::clearVertices( void )
+{
+	Vertices.clear();
+	Colors.clear();
+	BSplineSampled = false;
+}
+
+void Curve::addVertex( float x, float y )
+{
+	Vertices.push_back( x );
+	Vertices.push_back( y );
+	Vertices.push_back( 0.0f );
+	Vertices.push_back( 0.0f ); // Padding (not used)
+
+	Colors.insert( Colors.end(), Color, Color + 4 );
+}
+
+/*=================================================================================================
+  BEZIER
+=================================================================================================*/
+
+void Curve::SampleBezier( float samples )
+{
+	clearVertices();
+
+	const int count = GetControlPointCount();
+	if( count == 0 )
+		return;
+
+	int steps = (int)samples;
+	if( steps < 1 )
+		steps = 1;
+
+	const int degree = count - 1;
+	bool forward = ( Method == BEZIER_FORWARD_DIFFERENCES ) ||
+		( Method == BEZIER_AUTO && degree <= MaxForwardDifferenceDegree );
+
+	if( forward == true )
+	{
+		sampleBezierForward( steps );
+		return;
+	}
+
+	for( int k = 0; k <= steps; k++ )
+	{
+		double x, y;
+		evaluateBezier( (double)k / steps, x, y );
+		addVertex( (float)x, (float)y );
+	}
+}
+
+void Curve::EvaluateBezier( float t, float& x, float& y )
+{
+	double px = 0.0, py = 0.0;
+	if( ControlPoints.empty() == false )
+		evaluateBezier( t, px, py );
+
+	x = (float)px;
+	y = (float)py;
+}
+
+// Steps the curve with forward differences: degree additions per coordinate per sample. The starting
+// differences come exactly from the power basis instead of from sampled points, whose rounding errors
+// the running sums would multiply by up to steps^degree.
+void Curve::sampleBezierForward( int steps )
+{
+	const int count = GetControlPointCount();
+	const int degree = count - 1;
+	const double h = 1.0 / steps;
+
+	loadControlPoints();
+
+	Differences.assign( 2 * count, 0.0 );
+	Stirling.assign( count, 0.0 );
+
+	double binomial = 1.0; // C(n, j)
+	double hj = 1.0;       // h^j
+
+	for( int j = 0; j <= degree; j++ )
+	{
+		// Coefficient of k^j once t = k h: C(n, j) h^j times the j-th difference of the control points
+		double bx = binomial * hj * Table[0];
+		double by = binomial * hj * Table[1];
+
+		// Row j of i! S(j, i) (S: Stirling numbers of the second kind) from row j - 1
+		if( j == 0 )
+			Stirling[0] = 1.0;
+		else
+		{
+			for( int i = j; i >= 1; i-- )
+				Stirling[i] = i * ( Stirling[i] + Stirling[i - 1] );
+			Stirling[0] = 0.0;
+		}
+
+		// The i-th forward difference of k^j at k = 0 is i! S(j, i)
+		for( int i = 0; i <= j; i++ )
+		{
+			Differences[2 * i]     += bx * Stirling[i];
+			Differences[2 * i + 1] += by * Stirling[i];
+		}
+
+		// Next order of control point differences, in place
+		for( int i = 0; i < degree - j; i++ )
+		{
+			Table[2 * i]     = Table[2 * i + 2] - Table[2 * i];
+			Table[2 * i + 1] = Table[2 * i + 3] - Table[2 * i + 1];
+		}
+
+		binomial = binomial * ( degree - j ) / ( j + 1 );
+		hj *= h;
+	}
+
+	for( int k = 0; k <= steps; k++ )
+	{
+		addVertex( (float)Differences[0], (float)Differences[1] );
+
+		for( int i = 0; i < degree; i++ )
+		{
+			Differences[2 * i]     += Differences[2 * i + 2];
+			Differences[2 * i + 1] += Differences[2 * i + 3];
+		}
+	}
+}
+
+// Repeated linear interpolation of the control polygon, in double precision
+void Curve::evaluateBezier( double t, double& x, double& y )
+{
+	const int count = GetControlPointCount();
+	const double s = 1.0 - t;
+
+	loadControlPoints();
+
+	for( int r = count - 1; r > 0; r-- )
+	{
+		for( int i = 0; i < r; i++ )
+		{
+			Table[2 * i]     = s * Table[2 * i]     + t * Table[2 * i + 2];
+			Table[2 * i + 1] = s * Table[2 * i + 1] + t * Table[2 * i + 3];
+		}
+	}
+
+	x = Table[0];
+	y = Table[1];
+}
+
+void Curve::loadControlPoints( void )
+{
+	const int count = GetControlPointCount();
+
+	Table.resize( 2 * count );
+	for( int i = 0; i < count; i++ )
+	{
+		Table[2 * i]     = ControlPoints[i * 4];
+		Table[2 * i + 1] = ControlPoints[i * 4 + 1];
+	}
+}
+
+// Squared distance from p to the line through a and b (to a, if they coincide), times |b - a|^2
+static double distanceToChordSquared( double ax, double ay, double bx, double by, double px, double py, double& chordSquared )
+{
+	double dx = bx - ax;
+	double dy = by - ay;
+	chordSquared = dx * dx + dy * dy;
+
+	if( chordSquared == 0.0 )
+	{
+		chordSquared = 1.0;
+		return ( px - ax ) * ( px - ax ) + ( py - ay ) * ( py - ay );
+	}
+
+	double cross = dx * ( py - ay ) - dy * ( px - ax );
+	return cross * cross;
+}
+
+static bool withinTolerance( double ax, double ay, double bx, double by, double px, double py, double tolerance )
+{
+	double chordSquared;
+	double distance = distanceToChordSquared( ax, ay, bx, by, px, py, chordSquared );
+	return distance <= tolerance * tolerance * chordSquared;
+}
+
+void Curve::TessellateBezier( float tolerance )
+{
+	clearVertices();
+
+	const int count = GetControlPointCount();
+	if( count == 0 )
+		return;
+
+	loadControlPoints();
+
+	// Level 0 holds the whole control polygon; each level below holds a left half waiting its turn
+	const int stride = 2 * count;
+	Subdivision.resize( ( MaxSubdivisionDepth + 1 ) * stride );
+	std::copy( Table.begin(), Table.end(), Subdivision.begin() );
+
+	addVertex( (float)Table[0], (float)Table[1] );
+	subdivideBezier( 0, 0, tolerance );
+}
+
+// Emits the end point of the piece whose control polygon sits at level, once it is flat
+void Curve::subdivideBezier( int level, int depth, double tolerance )
+{
+	const int count = GetControlPointCount();
+	const int degree = count - 1;
+	double* polygon = &Subdivision[level * 2 * count];
+
+	// The piece lies within the hull of its control points, so it is as flat as they are
+	bool flat = true;
+	for( int i = 1; i < degree && flat == true; i++ )
+		flat = withinTolerance( polygon[0], polygon[1], polygon[2 * degree], polygon[2 * degree + 1], polygon[2 * i], polygon[2 * i + 1], tolerance );
+
+	if( flat == true || depth >= MaxSubdivisionDepth )
+	{
+		addVertex( (float)polygon[2 * degree], (float)polygon[2 * degree + 1] );
+		return;
+	}
+
+	// De Casteljau at t = 1/2: the left half goes one level down, the right half replaces this polygon
+	double* left = polygon + 2 * count;
+	Table.assign( polygon, polygon + 2 * count );
+
+	left[0] = Table[0];
+	left[1] = Table[1];
+
+	for( int r = 1; r <= degree; r++ )
+	{
+		for( int i = 0; i <= degree - r; i++ )
+		{
+			Table[2 * i]     = 0.5 * ( Table[2 * i]     + Table[2 * i + 2] );
+			Table[2 * i + 1] = 0.5 * ( Table[2 * i + 1] + Table[2 * i + 3] );
+		}
+
+		left[2 * r]     = Table[0];
+		left[2 * r + 1] = Table[1];
+		polygon[2 * ( degree - r )]     = Table[2 * ( degree - r )];
+		polygon[2 * ( degree - r ) + 1] = Table[2 * ( degree - r ) + 1];
+	}
+
+	subdivideBezier( level + 1, depth + 1, tolerance );
+	subdivideBezier( level, depth + 1, tolerance );
+}
+
+/*=================================================================================================
+  B-SPLINE
+=================================================================================================*/
+
+void Curve::SampleBSpline( float samples )
+{
+	clearVertices();
+
+	const int count = GetControlPointCount();
+	if( count <= Degree )
+		return;
+
+	int steps = (int)samples;
+	if( steps < 1 )
+		steps = 1;
+
+	if( BasisCacheValid == false || BasisCacheSteps != steps )
+		buildBasisCache( steps );
+
+	for( int k = 0; k <= steps; k++ )
+	{
+		double x, y;
+		bsplineSample( k, x, y );
+		addVertex( (float)x, (float)y );
+	}
+
+	BSplineSampled = true;
+}
+
+bool Curve::MoveBSplinePoint( int index, const float* point, int& first, int& count )
+{
+	first = 0;
+	count = 0;
+
+	// New knots or a new degree leave the samples of the old basis
+	if( BSplineSampled == false || BasisCacheValid == false || index < 0 || index >= GetControlPointCount() )
+		return false;
+
+	ControlPoints[index * 4] = point[0];
+	ControlPoints[index * 4 + 1] = point[1];
+	ControlPoints[index * 4 + 2] = point[2];
+	ControlPoints[index * 4 + 3] = point[3];
+
+	// The point weighs the spans index to index + Degree; samples run in span order, so the ones
+	// in those spans are consecutive
+	int begin = (int)( std::lower_bound( Spans.begin(), Spans.end(), index ) - Spans.begin() );
+	int end = (int)( std::upper_bound( Spans.begin(), Spans.end(), index + Degree ) - Spans.begin() );
+
+	for( int k = begin; k < end; k++ )
+	{
+		double x, y;
+		bsplineSample( k, x, y );
+		Vertices[k * 4] = (float)x;
+		Vertices[k * 4 + 1] = (float)y;
+	}
+
+	first = begin;
+	count = end - begin;
+
+	return true;
+}
+
+// Sample k of the basis cache: only the control points of its span have a nonzero weight
+void Curve::bsplineSample( int k, double& x, double& y ) const
+{
+	const int order = Degree + 1;
+	const double* basis = &BasisCache[k * order];
+	const float* p = &ControlPoints[( Spans[k] - Degree ) * 4];
+
+	x = 0.0;
+	y = 0.0;
+
+	for( int r = 0; r < order; r++ )
+	{
+		x += basis[r] * p[r * 4];
+		y += basis[r] * p[r * 4 + 1];
+	}
+}
+
+void Curve::buildKnots( void )
+{
+	const int numKnots = GetControlPointCount() + Degree + 1;
+
+	if( (int)Knots.size() == numKnots )
+		SplineKnots.assign( Knots.begin(), Knots.end() );
+	else
+	{
+		SplineKnots.resize( numKnots );
+		for( int i = 0; i < numKnots; i++ )
+			SplineKnots[i] = i;
+	}
+}
+
+void Curve::buildBasisCache( int steps )
+{
+	const int count = GetControlPointCount();
+	const int order = Degree + 1;
+
+	buildKnots();
+
+	// The domain, where a full set of Degree + 1 basis functions overlaps
+	const double first = SplineKnots[Degree];
+	const double last = SplineKnots[count];
+
+	Spans.resize( steps + 1 );
+	BasisCache.resize( ( steps + 1 ) * order );
+
+	for( int k = 0; k <= steps; k++ )
+	{
+		double t = ( k == steps ) ? last : first + ( last - first ) * k / steps;
+
+		Spans[k] = findSpan( t );
+		evaluateBasis( Spans[k], t, &BasisCache[k * order] );
+	}
+
+	BasisCacheSteps = steps;
+	BasisCacheValid = true;
+}
+
+// Binary search for the span [knot s, knot s + 1) that holds t; the end of the domain belongs to the last span
+int Curve::findSpan( double t ) const
+{
+	const int count = GetControlPointCount();
+
+	if( t >= SplineKnots[count] )
+		return count - 1;
+	if( t <= SplineKnots[Degree] )
+		return Degree;
+
+	int low = Degree;
+	int high = count;
+	int mid = ( low + high ) / 2;
+
+	while( t < SplineKnots[mid] || t >= SplineKnots[mid + 1] )
+	{
+		if( t < SplineKnots[mid] )
+			high = mid;
+		else
+			low = mid;
+
+		mid = ( low + high ) / 2;
+	}
+
+	return mid;
+}
+
+// Cox-de Boor without the recursion: the Degree + 1 basis functions that are nonzero on the span,
+// built up one degree at a time from the single order 1 function that is 1 there
+void Curve::evaluateBasis( int span, double t, double* basis )
+{
+	Left.resize( Degree + 1 );
+	Right.resize( Degree + 1 );
+
+	basis[0] = 1.0;
+
+	for( int j = 1; j <= Degree; j++ )
+	{
+		Left[j] = t - SplineKnots[span + 1 - j];
+		Right[j] = SplineKnots[span + j] - t;
+
+		double saved = 0.0;
+
+		for( int r = 0; r < j; r++ )
+		{
+			double term = basis[r] / ( Right[r + 1] + Left[j - r] );
+			basis[r] = saved + Right[r + 1] * term;
+			saved = Left[j - r] * term;
+		}
+
+		basis[j] = saved;
+	}
+}
+
+void Curve::evaluateBSpline( double t, double& x, double& y )
+{
+	const int span = findSpan( t );
+	const float* p = &ControlPoints[( span - Degree ) * 4];
+
+	Table.resize( Degree + 1 );
+	evaluateBasis( span, t, Table.data() );
+
+	x = 0.0;
+	y = 0.0;
+
+	for( int r = 0; r <= Degree; r++ )
+	{
+		x += Table[r] * p[r * 4];
+		y += Table[r] * p[r * 4 + 1];
+	}
+}
+
+void Curve::TessellateBSpline( float tolerance )
+{
+	clearVertices();
+
+	const int count = GetControlPointCount();
+	if( count <= Degree )
+		return;
+
+	buildKnots();
+
+	double x0, y0;
+	evaluateBSpline( SplineKnots[Degree], x0, y0 );
+	addVertex( (float)x0, (float)y0 );
+
+	// Every knot span is a separate polynomial piece, so pieces start out no longer than one span
+	for( int s = Degree; s < count; s++ )
+	{
+		double t0 = SplineKnots[s];
+		double t1 = SplineKnots[s + 1];
+		if( t1 <= t0 )
+			continue;
+
+		double x1, y1;
+		evaluateBSpline( t1, x1, y1 );
+
+		subdivideBSpline( t0, t1, x0, y0, x1, y1, 0, tolerance );
+
+		x0 = x1;
+		y0 = y1;
+	}
+}
+
+// Emits the end point of the piece over [t0, t1] once its midpoint and quarter points lie within tolerance of its chord
+void Curve::subdivideBSpline( double t0, double t1, double x0, double y0, double x1, double y1, int depth, double tolerance )
+{
+	const double tm = 0.5 * ( t0 + t1 );
+
+	double xm, ym;
+	evaluateBSpline( tm, xm, ym );
+
+	bool flat = ( depth >= MaxSubdivisionDepth );
+
+	if( flat == false && withinTolerance( x0, y0, x1, y1, xm, ym, tolerance ) == true )
+	{
+		double xq, yq;
+		evaluateBSpline( 0.5 * ( t0 + tm ), xq, yq );
+		flat = withinTolerance( x0, y0, x1, y1, xq, yq, tolerance );
+
+		if( flat == true )
+		{
+			evaluateBSpline( 0.5 * ( tm + t1 ), xq, yq );
+			flat = withinTolerance( x0, y0, x1, y1, xq, yq, tolerance );
+		}
+	}
+
+	if( flat == true )
+	{
+		addVertex( (float)x1, (float)y1 );
+		return;
+	}
+
+	subdivideBSpline( t0, tm, x0, y0, xm, ym, depth + 1, tolerance );
+	subdivideBSpline( tm, t1, xm, ym, x1, y1, depth + 1, tolerance );
+}
@@ -0,0 +1,110 @@
+#include "curvetessellator.h"
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+CurveTessellator::CurveTessellator()
+{
+	Created = false;
+	MaxLevel = 64;
+	SetColor( 1.0f, 1.0f, 1.0f, 1.0f );
+	Degree = 2;
+	VertexCount = 0;
+}
+
+/*=================================================================================================
+  SETTINGS
+=================================================================================================*/
+
+bool CurveTessellator::Create( std::string vspath, std::string tcspath, std::string tespath, std::string fspath )
+{
+	if( Created == true )
+		return true;
+
+	if( GLEW_VERSION_4_0 == false )
+		return false;
+
+	Program.Create( vspath, tcspath, tespath, fspath );
+	Created = ( Program.GetLinkStatus() == GL_TRUE );
+
+	// Segments per isoline; 64 is the least any implementation allows
+	glGetIntegerv( GL_MAX_TESS_GEN_LEVEL, &MaxLevel );
+
+	return Created;
+}
+
+void CurveTessellator::SetColor( float r, float g, float b, float a )
+{
+	Color[0] = r;
+	Color[1] = g;
+	Color[2] = b;
+	Color[3] = a;
+}
+
+void CurveTessellator::SetDegree( int degree )
+{
+	if( degree < 1 )
+		degree = 1;
+	if( degree > MaxDegree )
+		degree = MaxDegree;
+
+	Degree = degree;
+}
+
+/*=================================================================================================
+  DRAW
+=================================================================================================*/
+
+void CurveTessellator::DrawBezier( const MeshBuffer& points, int count, float samples )
+{
+	int steps = (int)samples;
+	if( steps < 1 )
+		steps = 1;
+
+	// As few isolines as the level limit allows, splitting the steps evenly between them
+	int lines = ( steps + MaxLevel - 1 ) / MaxLevel;
+
+	draw( points, count, CURVE_BEZIER, lines, steps );
+}
+
+void CurveTessellator::DrawBSpline( const MeshBuffer& points, int count, float samples )
+{
+	int steps = (int)samples;
+	if( steps < 1 )
+		steps = 1;
+
+	// One isoline per knot span of the domain
+	draw( points, count, CURVE_BSPLINE, count - Degree, steps );
+}
+
+void CurveTessellator::draw( const MeshBuffer& points, int count, CurveType type, int lines, int samples )
+{
+	VertexCount = 0;
+
+	if( Created == false || count < 1 || count > MaxControlPoints || lines < 1 )
+		return;
+
+	// Same split as curve.tesc, which works out the tessellation levels itself
+	int segments = ( samples + lines - 1 ) / lines;
+	if( segments > MaxLevel )
+		segments = MaxLevel;
+	VertexCount = lines * ( segments + 1 );
+
+	Program.Use();
+	Program.SetUniform( "curveType", (GLint)type );
+	Program.SetUniform( "samples", (GLint)samples );
+	Program.SetUniform( "degree", (GLint)Degree );
+	Program.SetUniform( "maxLevel", (GLint)MaxLevel );
+	Program.SetUniform( "color", Color[0], Color[1], Color[2], Color[3] );
+
+	// Any other size stands for the uniform knots, as in Curve::SetKnots
+	bool uniformKnots = ( (int)Knots.size() != count + Degree + 1 );
+	Program.SetUniform( "uniformKnots", (GLint)uniformKnots );
+	if( type == CURVE_BSPLINE && uniformKnots == false )
+		Program.SetUniform( "knots", Knots.data(), 1, (GLsizei)Knots.size() );
+
+	points.Bind();
+	glPatchParameteri( GL_PATCH_VERTICES, count );
+	glDrawArrays( GL_PATCHES, 0, count );
+}
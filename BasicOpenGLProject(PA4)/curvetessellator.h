@@ -0,0 +1,83 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include "meshbuffer.h"
+#include "shaderprogram.h"
+
+/**
+Draws the curves of Curve::SampleBezier and Curve::SampleBSpline in tessellation shaders, straight from
+a buffer of control points: the points are one patch, and the curve is evaluated between them while it
+is drawn. Moving a control point costs one update of that point, nothing is sampled or uploaded on the CPU.
+Needs OpenGL 4.0 for tessellation shaders.
+**/
+class CurveTessellator
+{
+public:
+	CurveTessellator();
+
+public:
+	/**
+	Builds the tessellation program. Returns false, leaving the tessellator unusable, when the context
+	lacks OpenGL 4.0 or the shaders fail to build.
+	*@param vspath Path of curve.vert.
+	*@param tcspath Path of curve.tesc.
+	*@param tespath Path of curve.tese.
+	*@param fspath Path of the fragment shader, which gets the curve color as vert_Color.
+	**/
+	bool Create( std::string vspath, std::string tcspath, std::string tespath, std::string fspath );
+
+	bool IsCreated() const { return Created; }
+
+	/**
+	Connects the Camera block of the evaluation shader to a uniform buffer binding point.
+	**/
+	void SetUniformBlockBinding( const GLchar* name, GLuint binding ) { Program.SetUniformBlockBinding( name, binding ); }
+
+	void SetColor( float r, float g, float b, float a );
+
+	/**
+	Same knots and degree as Curve::SetKnots and Curve::SetDegree; at most MaxDegree.
+	**/
+	void SetKnots( const std::vector<float>& knots ) { Knots = knots; }
+	void SetDegree( int degree );
+
+	//@{
+	/**
+	Draws the curve of the first count control points of a mesh, xyzw floats in attribute 0, with
+	the program of the tessellator, which stays in use. The Bezier is sampled in samples steps like
+	Curve::SampleBezier; the B-spline gets an equal share of them in every knot span.
+	*@param count Number of control points, at most MaxControlPoints.
+	**/
+	void DrawBezier( const MeshBuffer& points, int count, float samples );
+	void DrawBSpline( const MeshBuffer& points, int count, float samples );
+	//@}
+
+public:
+	// Vertices of the last draw, the samples the CPU would have uploaded for the same curve
+	GLsizei GetVertexCount() const { return VertexCount; }
+
+	// Must match the constants of curve.tesc and curve.tese
+	static const int MaxControlPoints = 32;
+	static const int MaxDegree = 7;
+
+private:
+	enum CurveType { CURVE_BEZIER = 0, CURVE_BSPLINE = 1 };
+
+	void draw( const MeshBuffer& points, int count, CurveType type, int lines, int samples );
+
+	CurveTessellator( const CurveTessellator& ) = delete;
+	CurveTessellator& operator=( const CurveTessellator& ) = delete;
+
+private:
+	ShaderProgram Program;
+	bool Created;
+	GLint MaxLevel;
+
+	float Color[4];
+	int Degree;
+	std::vector<float> Knots;
+
+	GLsizei VertexCount;
+};
@@ -5,8 +5,15 @@
 
 #include <math.h>
 #include <iostream>
+#include <cstring>
 #include "shader.h"
 #include "shaderprogram.h"
+#include "meshbuffer.h"
+#include "uniformbuffer.h"
+#include "headless.h"
+#include "profiler.h"
+#include "curve.h"
+#include "curvetessellator.h"
 #include <vector>
 
 /*=================================================================================================
@@ -19,6 +26,11 @@ const int InitWindowHeight = 800;
 int WindowWidth = InitWindowWidth;
 int WindowHeight = InitWindowHeight;
 
+// Renders a scripted camera path into image files instead of opening a window (--headless).
+// Declared before every GL object: globals are destroyed in reverse order, and this one's
+// destructor tears down the context the others still delete their names in
+HeadlessMode headless;
+
 // Last mouse cursor position
 int LastMousePosX = 0;
 int LastMousePosY = 0;
@@ -42,9 +54,32 @@ glm::mat4 PerspProjectionMatrix(1.0f);
 glm::mat4 PerspViewMatrix(1.0f);
 glm::mat4 PerspModelMatrix(1.0f);
 
+// Mirrors the std140 Camera block in the shaders (mat4 members need no padding)
+struct CameraUniforms
+{
+	glm::mat4 projectionMatrix;
+	glm::mat4 viewMatrix;
+	glm::mat4 modelMatrix;
+};
+
+// Uploaded once per frame and read by every program through the same binding point
+const GLuint CameraBinding = 0;
+UniformBuffer CameraBuffer;
+
 float perspZoom = 1.0f, perspSensitivity = 0.35f;
 float perspRotationX = 0.0f, perspRotationY = 0.0f;
 
+// Set whenever an input changes the camera or model transform; the matrices are only rebuilt then
+bool transforms_dirty = true;
+
+// Draw a new frame on every idle cycle instead of only after a change (--continuous, for benchmarking)
+bool continuous_rendering = false;
+
+// Per-pass CPU and GPU timings, reported every 120 frames (--profile, --profile-csv FILE)
+Profiler profiler;
+bool profiling_enabled = false;
+std::string profiling_csv = "";
+
 /*=================================================================================================
 	OBJECTS
 =================================================================================================*/
@@ -52,12 +87,9 @@ float perspRotationX = 0.0f, perspRotationY = 0.0f;
 //VAO -> the object "as a whole", the collection of buffers that make up its data
 //VBOs -> the individual buffers/arrays with data, for ex: one for coordinates, one for color, etc.
 
-GLuint poly_VAO;
-GLuint poly_VBO[2];
-GLuint point_VAO;
-GLuint point_VBO[2];
-GLuint curve_VAO;
-GLuint curve_VBO[2];
+MeshBuffer poly_Buffer;
+MeshBuffer point_Buffer;
+MeshBuffer curve_Buffer;
 
 float lines_vertices[] = {
 	-1.0f, 0.0f, 0.0f, 0.0f,
@@ -97,16 +129,30 @@ float point_colors[] = {
 	0.0f, 1.0f, 0.0f, 1.0f,
 };
 
-std::vector<float> curve_vertices;
-std::vector<float> curve_colors;
+// Samples of the current curve, regenerated from point_vertices on every edit
+Curve curve;
+
+// Knots of the B-spline; left empty for the uniform knots 0, 1, 2, ... of a quadratic B-spline
 std::vector<float> point_parameters;
 
 bool isBezier = true;
 float numT = 6;
 
+// Subdivide the curve until it is within flatnessTolerance pixels of its segments instead of sampling it numT times, toggled with 't'
+bool adaptiveTessellation = false;
+const float DefaultFlatnessTolerance = 0.5f;
+float flatnessTolerance = DefaultFlatnessTolerance;
+
+// Evaluates the curve in tessellation shaders from point_Buffer instead of sampling it on the CPU, toggled with 'g' (--gpu-curve)
+CurveTessellator curveTessellator;
+bool curveOnGPU = false;
+
+// Nothing is drawn until the first curve is created
+bool curveCreated = false;
+
 void createBezier(float);
 void createBSpline(float);
-float createBasis(int i, int k, float t);
+void moveControlPoint(int);
 
 
 /*=================================================================================================
@@ -140,10 +186,18 @@ void CreateTransformationMatrices(void)
 	PerspModelMatrix = glm::rotate(PerspModelMatrix, glm::radians(perspRotationX), glm::vec3(1.0, 0.0, 0.0));
 	PerspModelMatrix = glm::rotate(PerspModelMatrix, glm::radians(perspRotationY), glm::vec3(0.0, 1.0, 0.0));
 	PerspModelMatrix = glm::scale(PerspModelMatrix, glm::vec3(perspZoom));
+
+	// Upload once; every program with a Camera block reads it from the binding point
+	CameraUniforms camera = { PerspProjectionMatrix, PerspViewMatrix, PerspModelMatrix };
+	CameraBuffer.Create(CameraBinding, sizeof(camera));
+	CameraBuffer.SetData(&camera);
 }
 
 void CreateShaders(void)
 {
+	// Submit every program first, then collect all compile/link results together
+	ShaderProgram::BeginBatch();
+
 	// Renders without any transformations
 	PassthroughShader.Create("./shaders/simple.vert", "./shaders/simple.frag");
 
@@ -153,76 +207,53 @@ void CreateShaders(void)
 	//
 	// Additional shaders would be defined here
 	//
+
+	ShaderProgram::EndBatch();
+
+	// The camera matrices come from the shared uniform buffer instead of per-program uniforms
+	PassthroughShader.SetUniformBlockBinding("Camera", CameraBinding);
+	PerspectiveShader.SetUniformBlockBinding("Camera", CameraBinding);
 }
 
 /*=================================================================================================
 	BUFFERS
 =================================================================================================*/
 
+// The VAO and its buffers are made on the first call; later calls only refill them in place
 void CreatePolyBuffers(void)
 {
-	glGenVertexArrays(1, &poly_VAO); //generate 1 new VAO, its ID is returned in axis_VAO
-	glBindVertexArray(poly_VAO); //bind the VAO so the subsequent commands modify it
-
-	glGenBuffers(2, &poly_VBO[0]); //generate 2 buffers for data, their IDs are returned to the axis_VBO array
-
-	// first buffer: vertex coordinates
-	glBindBuffer(GL_ARRAY_BUFFER, poly_VBO[0]); //bind the first buffer using its ID
-	glBufferData(GL_ARRAY_BUFFER, sizeof(lines_vertices), lines_vertices, GL_STATIC_DRAW); //send coordinate array to the GPU
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0); //let GPU know this is attribute 0, made up of 4 floats
-	glEnableVertexAttribArray(0);
-
-	// second buffer: colors
-	glBindBuffer(GL_ARRAY_BUFFER, poly_VBO[1]); //bind the second buffer using its ID
-	glBufferData(GL_ARRAY_BUFFER, sizeof(line_colors), line_colors, GL_STATIC_DRAW); //send color array to the GPU
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0); //let GPU know this is attribute 1, made up of 4 floats
-	glEnableVertexAttribArray(1);
+	if (poly_Buffer.IsCreated() == false) {
+		poly_Buffer.Create(2);
+		poly_Buffer.SetAttribute(0, 0, 4); //first buffer: vertex coordinates, attribute 0 made up of 4 floats
+		poly_Buffer.SetAttribute(1, 1, 4); //second buffer: colors, attribute 1 made up of 4 floats
+	}
 
-	glBindVertexArray(0); //unbind when done
+	poly_Buffer.SetData(0, lines_vertices, sizeof(lines_vertices)); //send coordinate array to the GPU
+	poly_Buffer.SetData(1, line_colors, sizeof(line_colors)); //send color array to the GPU
 }
 
 void CreatePointBuffers(void)
 {
-	glGenVertexArrays(1, &point_VAO);
-	glBindVertexArray(point_VAO);
-
-	glGenBuffers(2, &point_VBO[0]);
-
-	// First buffer: vertex coordinates
-	glBindBuffer(GL_ARRAY_BUFFER, point_VBO[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(point_vertices), point_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	// Second buffer: colors
-	glBindBuffer(GL_ARRAY_BUFFER, point_VBO[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(point_colors), point_colors, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
+	if (point_Buffer.IsCreated() == false) {
+		point_Buffer.Create(2);
+		point_Buffer.SetAttribute(0, 0, 4);
+		point_Buffer.SetAttribute(1, 1, 4);
+	}
 
-	glBindVertexArray(0);
+	point_Buffer.SetData(0, point_vertices, sizeof(point_vertices));
+	point_Buffer.SetData(1, point_colors, sizeof(point_colors));
 }
 
 void CreateCurveBuffers(void)
 {
-	glGenVertexArrays(1, &curve_VAO);
-	glBindVertexArray(curve_VAO);
-
-	glGenBuffers(2, &curve_VBO[0]);
-
-	// First buffer: vertex coordinates
-	glBindBuffer(GL_ARRAY_BUFFER, curve_VBO[0]);
-	glBufferData(GL_ARRAY_BUFFER, curve_vertices.size() * sizeof(float), curve_vertices.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	// Second buffer: colors
-	glBindBuffer(GL_ARRAY_BUFFER, curve_VBO[1]);
-	glBufferData(GL_ARRAY_BUFFER, curve_colors.size() * sizeof(float), curve_colors.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
+	if (curve_Buffer.IsCreated() == false) {
+		curve_Buffer.Create(2);
+		curve_Buffer.SetAttribute(0, 0, 4);
+		curve_Buffer.SetAttribute(1, 1, 4);
+	}
 
-	glBindVertexArray(0);
+	curve_Buffer.SetData(0, curve.GetVertices().data(), curve.GetVertices().size() * sizeof(float));
+	curve_Buffer.SetData(1, curve.GetColors().data(), curve.GetColors().size() * sizeof(float));
 }
 
 /*=================================================================================================
@@ -235,9 +266,16 @@ void CreateCurveBuffers(void)
 // http://freeglut.sourceforge.net/docs/api.php#WindowCallback
 //-----------------------------------------------------------------------------
 
+// Rebuilds the matrices and draws one new frame once the pending events are handled
+void invalidate_transforms(void)
+{
+	transforms_dirty = true;
+	glutPostRedisplay();
+}
+
+// Only registered in continuous mode; otherwise frames are drawn on demand
 void idle_func()
 {
-	//uncomment below to repeatedly draw new frames
 	glutPostRedisplay();
 }
 
@@ -247,7 +285,7 @@ void reshape_func(int width, int height)
 	WindowHeight = height;
 
 	glViewport(0, 0, width, height);
-	glutPostRedisplay();
+	invalidate_transforms();
 }
 
 void keyboard_func(unsigned char key, int x, int y)
@@ -265,15 +303,8 @@ void keyboard_func(unsigned char key, int x, int y)
 		// Also the corresponding line vertex
 		lines_vertices[selectedPoint * 4 + 1] += 0.05f;
 
-		// Redraw selected curve
-		if (isBezier)
-			createBezier(numT);
-		else
-			createBSpline(numT);
-
-		// Recreate buffers
-		CreatePointBuffers();
-		CreatePolyBuffers();
+		// Update the point, its line vertex and the part of the curve it moved
+		moveControlPoint(selectedPoint);
 		break;
 	}
 
@@ -286,15 +317,8 @@ void keyboard_func(unsigned char key, int x, int y)
 		// Also move the corresponding line vertex
 		lines_vertices[selectedPoint * 4 + 1] -= 0.05f;
 
-		// Redraw selected curve
-		if (isBezier)
-			createBezier(numT);
-		else
-			createBSpline(numT);
-
-		// Recreate buffers
-		CreatePointBuffers();
-		CreatePolyBuffers();
+		// Update the point, its line vertex and the part of the curve it moved
+		moveControlPoint(selectedPoint);
 		break;
 	}
 
@@ -307,15 +331,8 @@ void keyboard_func(unsigned char key, int x, int y)
 		// Also move the corresponding line vertex
 		lines_vertices[selectedPoint * 4] -= 0.05f;
 
-		// Redraw selected curve
-		if (isBezier)
-			createBezier(numT);
-		else
-			createBSpline(numT);
-
-		// Recreate buffers
-		CreatePointBuffers();
-		CreatePolyBuffers();
+		// Update the point, its line vertex and the part of the curve it moved
+		moveControlPoint(selectedPoint);
 		break;
 	}
 
@@ -328,15 +345,8 @@ void keyboard_func(unsigned char key, int x, int y)
 		// Also move the corresponding line vertex
 		lines_vertices[selectedPoint * 4] += 0.05f;
 
-		// Redraw selected curve
-		if (isBezier)
-			createBezier(numT);
-		else
-			createBSpline(numT);
-
-		// Recreate buffers
-		CreatePointBuffers();
-		CreatePolyBuffers();
+		// Update the point, its line vertex and the part of the curve it moved
+		moveControlPoint(selectedPoint);
 		break;
 	}
 
@@ -407,8 +417,11 @@ void keyboard_func(unsigned char key, int x, int y)
 	// Increase resolution
 	case 'z':
 	{
-		// Increment res by 4
-		numT += 4.0f;
+		// Increment res by 4, or halve the adaptive tolerance
+		if (adaptiveTessellation)
+			flatnessTolerance *= 0.5f;
+		else
+			numT += 4.0f;
 
 		// Recreate buffers
 		if (isBezier)
@@ -421,8 +434,10 @@ void keyboard_func(unsigned char key, int x, int y)
 	// Decrease resolution
 	case 'x':
 	{
-		// Decrement res by 4 but not to below 4
-		if (numT > 4)
+		// Decrement res by 4 but not to below 4, or double the adaptive tolerance
+		if (adaptiveTessellation)
+			flatnessTolerance *= 2.0f;
+		else if (numT > 4)
 			numT -= 4.0f;
 
 		// Recreate buffers
@@ -436,8 +451,9 @@ void keyboard_func(unsigned char key, int x, int y)
 	// Reset resolution
 	case 'c':
 	{
-		// Reset granularity to 4
+		// Reset granularity to 4 and the adaptive tolerance to its default
 		numT = 4.0f;
+		flatnessTolerance = DefaultFlatnessTolerance;
 
 		// Recreate buffers
 		if (isBezier)
@@ -461,13 +477,57 @@ void keyboard_func(unsigned char key, int x, int y)
 		break;
 	}
 
+	// Toggle between uniform sampling and adaptive subdivision
+	case 't':
+	{
+		adaptiveTessellation = !adaptiveTessellation;
+
+		// Recreate buffers
+		if (isBezier)
+			createBezier(numT);
+		else
+			createBSpline(numT);
+
+		std::cout << (adaptiveTessellation ? "Adaptive" : "Uniform") << " curve tessellation.\n";
+		break;
+	}
+
+	// Toggle between sampling the curve on the CPU and evaluating it in tessellation shaders
+	case 'g':
+	{
+		if (curveOnGPU == false && curveTessellator.IsCreated() == false) {
+			std::cout << "Tessellation shaders need OpenGL 4.0, the curve stays on the CPU.\n";
+			break;
+		}
+
+		curveOnGPU = !curveOnGPU;
+
+		// Recreate buffers
+		if (isBezier)
+			createBezier(numT);
+		else
+			createBSpline(numT);
+
+		if (curveOnGPU)
+			std::cout << "Curve evaluated by tessellation shaders.\n";
+		else
+			std::cout << "Curve sampled on the CPU.\n";
+		break;
+	}
+
 	// Exit the application on Escape key press
 	case '\x1B':
 	{
 		exit(EXIT_SUCCESS);
 		break;
 	}
+
+	// Keys without a binding change nothing on screen
+	default:
+		return;
 	}
+
+	glutPostRedisplay();
 }
 
 
@@ -503,11 +563,15 @@ void mouse_func(int button, int state, int x, int y)
 	if (button == 3)
 	{
 		perspZoom += 0.03f;
+		invalidate_transforms();
 	}
 	else if (button == 4)
 	{
-		if (perspZoom - 0.03f > 0.0f)
+		// At the zoom floor nothing changes, so nothing is redrawn
+		if (perspZoom - 0.03f > 0.0f) {
 			perspZoom -= 0.03f;
+			invalidate_transforms();
+		}
 	}
 
 	mouse_states[button] = (state == GLUT_DOWN);
@@ -547,65 +611,29 @@ void active_motion_func(int x, int y)
 }
 
 
+// The flatness tolerance in curve units: how far flatnessTolerance pixels reach at the curve's depth and zoom
+float curveTolerance(void)
+{
+	// The curve lies in the z = 0 plane of the model, which the model matrix only scales by the zoom
+	float depth = -(PerspViewMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).z;
+	float unitsPerPixel = 2.0f * depth / (PerspProjectionMatrix[1][1] * WindowHeight);
+
+	return flatnessTolerance * unitsPerPixel / perspZoom;
+}
+
 void createBezier(float tSize) {
-	// Clear vecs
-	curve_vertices.clear();
-	curve_colors.clear();
-
-	// Calculate step size for t based on tSize
-	float t = 1.0f / tSize;
-
-	// Iterate through values 0 to 1 in steps of t
-	for (float i = 0; i <= 1; i += t) {
-		// Calculate x and y coordinates for Bezier curve using de Casteljau's
-
-		// The de Casteljau algorithm calculates points on the Bezier
-		// Recursively interpolating points between control points.
-
-		// For each i, calculate x-coordinate of the point on the curve.
-
-		float x = 
-			// Calculate the x-coordinate using the formula for Bezier interpolation.
-			// Each term in the sum represents the contribution of a control point to the curve at parameter value i (6 control points)
-			powf(1 - i, 5.0) * point_vertices[0] +
-			5 * i * powf(1.0f - i, 4) * point_vertices[4] +
-			10 * powf(i, 2) * powf(1 - i, 3) * point_vertices[8] +
-			10 * powf(i, 3) * powf(1 - i, 2) * point_vertices[12] +
-			5 * powf(i, 4) * (1 - i) * point_vertices[16] +
-			powf(i, 5) * point_vertices[20];
-
-		float y = 
-			// Calculate the y-coordinate using the formula for Bezier interpolation.
-			// Similar to the x-coordinate calculation, each term represents the contribution of a control point.
-			powf(1 - i, 5.0) * point_vertices[1] +
-			5 * i * powf(1.0f - i, 4) * point_vertices[5] +
-			10 * powf(i, 2) * powf(1 - i, 3) * point_vertices[9] +
-			10 * powf(i, 3) * powf(1 - i, 2) * point_vertices[13] +
-			5 * powf(i, 4) * (1 - i) * point_vertices[17] +
-			powf(i, 5) * point_vertices[21];
-
-		// Add vertex to vertex vector
-		curve_vertices.push_back(x);
-		curve_vertices.push_back(y);
-		curve_vertices.push_back(0.0f); 
-		curve_vertices.push_back(0.0f); // Padding (not used)
-
-		// Color (red)
-		curve_colors.push_back(1.0);
-		curve_colors.push_back(0.0);
-		curve_colors.push_back(0.0);
-		curve_colors.push_back(1.0);
-	}
+	curveCreated = true;
 
-	// Add the last control point to ensure the curve passes through it
-	curve_vertices.push_back(point_vertices[20]);
-	curve_vertices.push_back(point_vertices[21]);
-	curve_vertices.push_back(0.0f);
-	curve_vertices.push_back(0.0f);
-	curve_colors.push_back(1.0);
-	curve_colors.push_back(0.0);
-	curve_colors.push_back(0.0);
-	curve_colors.push_back(1.0);
+	// The tessellation shaders read the control points from point_Buffer, which the edit has already updated
+	if (curveOnGPU)
+		return;
+
+	// Bezier of the six control points (degree 5), sampled in tSize steps
+	curve.SetControlPoints(point_vertices, 6);
+	if (adaptiveTessellation)
+		curve.TessellateBezier(curveTolerance());
+	else
+		curve.SampleBezier(tSize);
 
 	// Update buffers
 	CreateCurveBuffers();
@@ -613,79 +641,46 @@ void createBezier(float tSize) {
 
 void createBSpline(float tSize)
 {
-	int n = 6; // Control points
-
-	// Clear vectors
-	curve_vertices.clear();
-	curve_colors.clear();
-
-	// Calculate step size for t based on tSize
-	float tStep = 2.0f / tSize; // Quadratic B-spline has domain [2, 4]
-
-	// Iterate from 2 to 4 in steps of tStep
-	for (float t = 2; t <= 4; t += tStep)
-	{
-		float x = 0;
-		float y = 0;
-
-		// Compute x and y coordinates of B-spline curve at parameter t
-		for (int i = 0; i < n; i++)
-		{
-			// Calculate B-spline basis function value for i-th control point
-			float basis = createBasis(i, 2, t); // Using quadratic basis function
-			x += basis * point_vertices[i * 4];     // Multiply basis by x-coordinate of control point
-			y += basis * point_vertices[i * 4 + 1]; // Multiply basis by y-coordinate of control point
-		}
+	curveCreated = true;
 
-		// Computed vertex to vertices vector
-		curve_vertices.push_back(x);
-		curve_vertices.push_back(y);
-		curve_vertices.push_back(0.0f);
-		curve_vertices.push_back(0.0f); // Padding (not used)
-
-		// Color (red)
-		curve_colors.push_back(1.0);
-		curve_colors.push_back(0.0);
-		curve_colors.push_back(0.0);
-		curve_colors.push_back(1.0);
+	// Only the knots are passed on, the control points are read from point_Buffer
+	if (curveOnGPU) {
+		curveTessellator.SetKnots(point_parameters);
+		return;
 	}
 
-	// Update buffers 
-	CreateCurveBuffers(); 
-}
+	// Quadratic B-spline of the six control points over the knots in point_parameters, sampled in tSize steps
+	curve.SetControlPoints(point_vertices, 6);
+	curve.SetKnots(point_parameters);
+	if (adaptiveTessellation)
+		curve.TessellateBSpline(curveTolerance());
+	else
+		curve.SampleBSpline(tSize);
 
+	// Update buffers
+	CreateCurveBuffers();
+}
 
-// Compute the basis function for a given index i, degree k, and parameter t
-float createBasis(int i, int k, float t)
+// After control point index moved: rewrites only what changed in the point, polygon and curve buffers
+void moveControlPoint(int index)
 {
-	// Check for out-of-bounds
-	if (i < 0 || i + k - 1 >= point_parameters.size() || i >= point_parameters.size()) {
-		// Handle out-of-bounds indices by returning 0.0f
-		return 0.0f;
+	const GLsizeiptr pointSize = 4 * sizeof(float);
+	point_Buffer.UpdateData(0, index * pointSize, &point_vertices[index * 4], pointSize);
+	poly_Buffer.UpdateData(0, index * pointSize, &lines_vertices[index * 4], pointSize);
+
+	// A sampled B-spline only changes in the few spans the point weighs, however long the curve
+	int first, count;
+	if (isBezier == false && adaptiveTessellation == false && curveOnGPU == false &&
+		curve.MoveBSplinePoint(index, &point_vertices[index * 4], first, count) == true) {
+		curve_Buffer.UpdateData(0, first * pointSize, &curve.GetVertices()[first * 4], count * pointSize);
+		return;
 	}
-	else
-	{
-		// Recursive - Cox-de Boor recursion
 
-		// Initial left and right basis values
-		float basis_left = 0.0f;
-		float basis_right = 0.0f;
-
-		// Compute left basis value if denominator non-zero
-		if (point_parameters[i + k - 1] != point_parameters[i]) {
-			// Compute the left basis recursively
-			basis_left = (t - point_parameters[i]) / (point_parameters[i + k - 1] - point_parameters[i]) * createBasis(i, k - 1, t);
-		}
-
-		// Compute right basis value if denominator is non-zero
-		if (point_parameters[i + k] != point_parameters[i + 1]) {
-			// Compute the right basis recursively
-			basis_right = (point_parameters[i + k] - t) / (point_parameters[i + k] - point_parameters[i + 1]) * createBasis(i + 1, k - 1, t);
-		}
-
-		// Sum of left and right basis values
-		return basis_left + basis_right;
-	}
+	// Every other curve depends on all of its points
+	if (isBezier)
+		createBezier(numT);
+	else
+		createBSpline(numT);
 }
 
 
@@ -694,19 +689,32 @@ float createBasis(int i, int k, float t)
 	RENDERING
 =================================================================================================*/
 
-void display_func(void)
+// Draws one frame into the bound framebuffer: the window's back buffer, or the offscreen one when headless
+void render_scene(void)
 {
+	profiler.BeginFrame();
+
 	// Clear the contents of the back buffer
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Update transformation matrices
-	CreateTransformationMatrices();
+	// Update transformation matrices, only if an input changed them since the last frame
+	if (transforms_dirty == true)
+	{
+		CreateTransformationMatrices();
+		transforms_dirty = false;
+
+		// An adaptive curve's tolerance follows the zoom and the window size
+		if (adaptiveTessellation == true && curveOnGPU == false && curveCreated == true)
+		{
+			if (isBezier)
+				createBezier(numT);
+			else
+				createBSpline(numT);
+		}
+	}
 
-	// Choose which shader to use, and send the transformation matrix information to it
+	// Choose which shader to use; the transformation matrices are already in the camera buffer
 	PerspectiveShader.Use();
-	PerspectiveShader.SetUniform("projectionMatrix", glm::value_ptr(PerspProjectionMatrix), 4, GL_FALSE, 1);
-	PerspectiveShader.SetUniform("viewMatrix", glm::value_ptr(PerspViewMatrix), 4, GL_FALSE, 1);
-	PerspectiveShader.SetUniform("modelMatrix", glm::value_ptr(PerspModelMatrix), 4, GL_FALSE, 1);
 
 	// Drawing in wireframe?
 	if (draw_wireframe == true)
@@ -715,24 +723,56 @@ void display_func(void)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
 	// Bind the point VAO and draw control points
-	glBindVertexArray(point_VAO);
+	profiler.Begin("points");
+	point_Buffer.Bind();
 	glDrawArrays(GL_POINTS, 0, 6);
+	profiler.End();
 
 	// Bind the curve VAO and draw the B-spline curve
-	glBindVertexArray(curve_VAO);
-	glDrawArrays(GL_LINE_STRIP, 0, curve_vertices.size() / 4);
+	profiler.Begin("curve");
+	if (curveOnGPU) {
+		// Drawn from the control points, with the tessellator's own program
+		if (curveCreated && isBezier)
+			curveTessellator.DrawBezier(point_Buffer, 6, numT);
+		else if (curveCreated)
+			curveTessellator.DrawBSpline(point_Buffer, 6, numT);
+		PerspectiveShader.Use();
+	}
+	else {
+		curve_Buffer.Bind();
+		glDrawArrays(GL_LINE_STRIP, 0, curve.GetVertexCount());
+	}
+	profiler.End();
 
 	// Bind the polygon VAO and draw the polygon
-	glBindVertexArray(poly_VAO);
+	profiler.Begin("polygon");
+	poly_Buffer.Bind();
 	glDrawArrays(GL_LINE_STRIP, 0, 6);
+	profiler.End();
 
 	// Unbind VAO when done
 	glBindVertexArray(0);
 
+	profiler.EndFrame();
+}
+
+void display_func(void)
+{
+	render_scene();
+
 	// Swap the front and back buffers
 	glutSwapBuffers();
 }
 
+// Headless mode moves the same orbit camera the mouse does
+void apply_camera_key(const CameraKey& key)
+{
+	perspRotationX = key.RotationX;
+	perspRotationY = key.RotationY;
+	perspZoom = key.Zoom;
+	transforms_dirty = true;
+}
+
 
 /*=================================================================================================
 	INIT
@@ -759,20 +799,23 @@ void init(void)
 	CreatePolyBuffers();
 	CreatePointBuffers();	
 
-	// Initialize the curve VAO
-	glGenVertexArrays(1, &curve_VAO);
-	glBindVertexArray(curve_VAO);
-
-	// Bind the curve VBO
-	glBindBuffer(GL_ARRAY_BUFFER, curve_VBO[0]);
+	// Initialize the curve VAO, it stays empty until a curve is generated
+	curve.SetColor(1.0f, 0.0f, 0.0f, 1.0f);
+	CreateCurveBuffers();
 
-	// Specify the layout of the vertex data
-	// Assuming each vertex consists of 4 floats (x, y, z, padding)
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	// Tessellation shaders need GL 4.0; without them the curve is always sampled on the CPU
+	if (curveTessellator.Create("./shaders/curve.vert", "./shaders/curve.tesc", "./shaders/curve.tese", "./shaders/persp.frag") == true) {
+		curveTessellator.SetColor(1.0f, 0.0f, 0.0f, 1.0f);
+		curveTessellator.SetUniformBlockBinding("Camera", CameraBinding);
+	}
+	else if (curveOnGPU) {
+		std::cout << "Tessellation shaders need OpenGL 4.0, the curve stays on the CPU.\n\n";
+		curveOnGPU = false;
+	}
 
-	// Unbind the curve VAO
-	glBindVertexArray(0);
+	// Timer queries need the context, so profiling is switched on here rather than in main
+	profiler.SetOutputFile(profiling_csv);
+	profiler.SetEnabled(profiling_enabled);
 
 	std::cout << "Finished initializing...\n\n";
 
@@ -784,6 +827,39 @@ void init(void)
 
 int main(int argc, char** argv)
 {
+	// Viewer options; GLUT's own (-display, -geometry, ...) are left alone for glutInit
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--continuous") == 0)
+			continuous_rendering = true;
+		else if (strcmp(argv[i], "--gpu-curve") == 0)
+			curveOnGPU = true;
+		else if (strcmp(argv[i], "--profile") == 0)
+			profiling_enabled = true;
+		else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc)
+		{
+			profiling_enabled = true;
+			profiling_csv = argv[++i];
+		}
+	}
+
+	// Without a window: render the frames, write them out and quit
+	if (headless.ParseArguments(argc, argv) == true)
+	{
+		WindowWidth  = headless.GetWidth();
+		WindowHeight = headless.GetHeight();
+
+		if (headless.CreateContext(argc, argv) == false)
+			return -1;
+
+		init();
+		int status = headless.Run(apply_camera_key, render_scene);
+
+		// Whatever is left since the last periodic report
+		profiler.Report();
+		return status;
+	}
+
 	// Create and initialize the OpenGL context
 	glutInit(&argc, argv);
 
@@ -803,7 +879,8 @@ int main(int argc, char** argv)
 
 	// Register callback functions
 	glutDisplayFunc(display_func);
-	glutIdleFunc(idle_func);
+	if (continuous_rendering == true)
+		glutIdleFunc(idle_func);
 	glutReshapeFunc(reshape_func);
 	glutKeyboardFunc(keyboard_func);
 	glutKeyboardUpFunc(key_released);
@@ -0,0 +1,162 @@
+#include "meshbuffer.h"
+#include <cstddef>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+MeshBuffer::MeshBuffer()
+{
+	VAO = 0;
+	Usage = GL_DYNAMIC_DRAW;
+	Indices = { 0, 0, 0 };
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+MeshBuffer::~MeshBuffer()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+void MeshBuffer::Create( GLuint numBuffers, GLenum usage )
+{
+	if( VAO != 0 )
+		return;
+
+	Usage = usage;
+
+	glGenVertexArrays( 1, &VAO );
+
+	std::vector<GLuint> ids( numBuffers );
+	if( numBuffers > 0 )
+		glGenBuffers( numBuffers, ids.data() );
+
+	Buffers.resize( numBuffers );
+	for( GLuint i = 0; i < numBuffers; i++ )
+		Buffers[ i ] = { ids[ i ], 0, 0 };
+}
+
+void MeshBuffer::Delete( void )
+{
+	if( VAO == 0 )
+		return;
+
+	for( size_t i = 0; i < Buffers.size(); i++ )
+		glDeleteBuffers( 1, &Buffers[ i ].ID );
+
+	if( Indices.ID != 0 )
+		glDeleteBuffers( 1, &Indices.ID );
+
+	glDeleteVertexArrays( 1, &VAO );
+
+	VAO = 0;
+	Buffers.clear();
+	Indices = { 0, 0, 0 };
+}
+
+void MeshBuffer::Bind( void ) const
+{
+	glBindVertexArray( VAO );
+}
+
+void MeshBuffer::Unbind( void ) const
+{
+	glBindVertexArray( 0 );
+}
+
+/*=================================================================================================
+  ATTRIBUTES
+=================================================================================================*/
+
+void MeshBuffer::SetAttribute( GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset )
+{
+	glBindVertexArray( VAO );
+	glBindBuffer( GL_ARRAY_BUFFER, Buffers[ buffer ].ID );
+
+	glVertexAttribPointer( index, size, type, normalized, stride, (void*)offset );
+
+	glEnableVertexAttribArray( index );
+	glBindVertexArray( 0 );
+}
+
+void MeshBuffer::SetFormat( GLuint buffer, const VertexFormat& format )
+{
+	const std::vector<VertexAttribute>& attributes = format.GetAttributes();
+
+	for( size_t i = 0; i < attributes.size(); i++ )
+	{
+		const VertexAttribute& attribute = attributes[ i ];
+		SetAttribute( buffer, attribute.Location, attribute.Size, attribute.Type, attribute.Normalized, format.GetStride(), attribute.Offset );
+	}
+}
+
+void MeshBuffer::SetDivisor( GLuint index, GLuint divisor )
+{
+	glBindVertexArray( VAO );
+	glVertexAttribDivisor( index, divisor );
+	glBindVertexArray( 0 );
+}
+
+/*=================================================================================================
+  DATA
+=================================================================================================*/
+
+void MeshBuffer::SetData( GLuint buffer, const void* data, GLsizeiptr size )
+{
+	upload( GL_ARRAY_BUFFER, Buffers[ buffer ], data, size );
+}
+
+void MeshBuffer::SetIndexData( const void* data, GLsizeiptr size )
+{
+	// The element buffer binding is part of the vertex array state
+	glBindVertexArray( VAO );
+
+	if( Indices.ID == 0 )
+		glGenBuffers( 1, &Indices.ID );
+
+	upload( GL_ELEMENT_ARRAY_BUFFER, Indices, data, size );
+
+	glBindVertexArray( 0 );
+}
+
+void MeshBuffer::UpdateData( GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size )
+{
+	if( size <= 0 || offset + size > Buffers[ buffer ].Size )
+		return;
+
+	glBindBuffer( GL_ARRAY_BUFFER, Buffers[ buffer ].ID );
+	glBufferSubData( GL_ARRAY_BUFFER, offset, size, data );
+}
+
+void MeshBuffer::upload( GLenum target, Storage& storage, const void* data, GLsizeiptr size )
+{
+	glBindBuffer( target, storage.ID );
+
+	if( size > storage.Capacity )
+	{
+		// Grow geometrically so a mesh that keeps getting bigger reallocates O(log n) times
+		GLsizeiptr capacity = storage.Capacity * 2;
+		if( capacity < size )
+			capacity = size;
+
+		glBufferData( target, capacity, NULL, Usage );
+		storage.Capacity = capacity;
+	}
+	else if( storage.Capacity > 0 )
+	{
+		// Orphan the old storage so the GPU can keep reading it while we write the new contents
+		glBufferData( target, storage.Capacity, NULL, Usage );
+	}
+
+	if( size > 0 && data != NULL )
+		glBufferSubData( target, 0, size, data );
+
+	storage.Size = size;
+}
@@ -1,5 +1,21 @@
 #include "shaderprogram.h"
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+std::string ShaderProgram::BinaryCacheDirectory = "./shadercache";
+bool ShaderProgram::Batching = false;
+std::vector<ShaderProgram*> ShaderProgram::PendingPrograms;
 
 /*=================================================================================================
   CONSTRUCTORS
@@ -8,23 +24,30 @@
 ShaderProgram::ShaderProgram()
 {
 	ID = 0;
+	uniformCount = 0;
+	linkedFromBinary = false;
 }
 
-ShaderProgram::ShaderProgram( std::string cspath )
+ShaderProgram::ShaderProgram( std::string cspath ) : ShaderProgram()
 {
 	Create( cspath );
 }
 
-ShaderProgram::ShaderProgram( std::string vspath, std::string fspath )
+ShaderProgram::ShaderProgram( std::string vspath, std::string fspath ) : ShaderProgram()
 {
 	Create( vspath, fspath );
 }
 
-ShaderProgram::ShaderProgram( std::string vspath, std::string gspath, std::string fspath )
+ShaderProgram::ShaderProgram( std::string vspath, std::string gspath, std::string fspath ) : ShaderProgram()
 {
 	Create( vspath, gspath, fspath );
 }
 
+ShaderProgram::ShaderProgram( std::string vspath, std::string tcspath, std::string tespath, std::string fspath ) : ShaderProgram()
+{
+	Create( vspath, tcspath, tespath, fspath );
+}
+
 /*=================================================================================================
   DESTRUCTOR
 =================================================================================================*/
@@ -44,10 +67,10 @@ void ShaderProgram::Create( std::string cspath )
 
 	if( ID != 0 )
 	{
-		computeShader.Create( cspath, GL_COMPUTE_SHADER );
+		computeShader.Create( cspath, GL_COMPUTE_SHADER, false );
 		glAttachShader( ID, computeShader.GetID() );
 
-		Link();
+		build();
 	}
 }
 
@@ -57,13 +80,13 @@ void ShaderProgram::Create( std::string vspath, std::string fspath )
 
 	if( ID != 0 )
 	{
-		vertexShader.Create( vspath, GL_VERTEX_SHADER );
+		vertexShader.Create( vspath, GL_VERTEX_SHADER, false );
 		glAttachShader( ID, vertexShader.GetID() );
 
-		fragmentShader.Create( fspath, GL_FRAGMENT_SHADER );
+		fragmentShader.Create( fspath, GL_FRAGMENT_SHADER, false );
 		glAttachShader( ID, fragmentShader.GetID() );
 
-		Link();
+		build();
 	}
 }
 
@@ -73,16 +96,113 @@ void ShaderProgram::Create( std::string vspath, std::string gspath, std::string
 
 	if( ID != 0 )
 	{
-		vertexShader.Create( vspath, GL_VERTEX_SHADER );
+		vertexShader.Create( vspath, GL_VERTEX_SHADER, false );
 		glAttachShader( ID, vertexShader.GetID() );
 
-		geometryShader.Create( gspath, GL_GEOMETRY_SHADER );
+		geometryShader.Create( gspath, GL_GEOMETRY_SHADER, false );
 		glAttachShader( ID, geometryShader.GetID() );
 
-		fragmentShader.Create( fspath, GL_FRAGMENT_SHADER );
+		fragmentShader.Create( fspath, GL_FRAGMENT_SHADER, false );
+		glAttachShader( ID, fragmentShader.GetID() );
+
+		build();
+	}
+}
+
+void ShaderProgram::Create( std::string vspath, std::string tcspath, std::string tespath, std::string fspath )
+{
+	ID = glCreateProgram();
+
+	if( ID != 0 )
+	{
+		vertexShader.Create( vspath, GL_VERTEX_SHADER, false );
+		glAttachShader( ID, vertexShader.GetID() );
+
+		tessControlShader.Create( tcspath, GL_TESS_CONTROL_SHADER, false );
+		glAttachShader( ID, tessControlShader.GetID() );
+
+		tessEvaluationShader.Create( tespath, GL_TESS_EVALUATION_SHADER, false );
+		glAttachShader( ID, tessEvaluationShader.GetID() );
+
+		fragmentShader.Create( fspath, GL_FRAGMENT_SHADER, false );
 		glAttachShader( ID, fragmentShader.GetID() );
 
-		Link();
+		build();
+	}
+}
+
+// Shaders are attached but not compiled yet; a cached binary makes compiling them unnecessary
+void ShaderProgram::build( void )
+{
+	linkedFromBinary = loadProgramBinary();
+
+	if( linkedFromBinary == false )
+	{
+		vertexShader.Compile();
+		tessControlShader.Compile();
+		tessEvaluationShader.Compile();
+		geometryShader.Compile();
+		fragmentShader.Compile();
+		computeShader.Compile();
+		submitLink();
+	}
+
+	if( Batching == true )
+		PendingPrograms.push_back( this );
+	else
+		finishLink();
+}
+
+/*=================================================================================================
+  BATCH
+=================================================================================================*/
+
+void ShaderProgram::BeginBatch( void )
+{
+	Batching = true;
+
+	// Let the driver pick how many compiler threads to use
+#ifdef GL_KHR_parallel_shader_compile
+	if( GLEW_KHR_parallel_shader_compile )
+		glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+	if( GLEW_ARB_parallel_shader_compile )
+		glMaxShaderCompilerThreadsARB( 0xFFFFFFFF );
+#endif
+}
+
+void ShaderProgram::EndBatch( void )
+{
+	Batching = false;
+
+	// Finish programs in the order the driver completes them when it can tell us, otherwise in order
+	bool canPoll = false;
+#ifdef GL_KHR_parallel_shader_compile
+	canPoll = canPoll || GLEW_KHR_parallel_shader_compile;
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+	canPoll = canPoll || GLEW_ARB_parallel_shader_compile;
+#endif
+
+	while( PendingPrograms.empty() == false )
+	{
+		size_t next = 0;
+
+		if( canPoll == true )
+		{
+			for( size_t i = 0; i < PendingPrograms.size(); i++ )
+			{
+				if( PendingPrograms[i]->GetStatus( GL_COMPLETION_STATUS_KHR ) == 1 )
+				{
+					next = i;
+					break;
+				}
+			}
+		}
+
+		PendingPrograms[next]->finishLink();
+		PendingPrograms.erase( PendingPrograms.begin() + next );
 	}
 }
 
@@ -95,6 +215,8 @@ void ShaderProgram::Delete( void )
 	if( ID != 0 )
 	{
 		glDetachShader( ID, vertexShader.GetID() );
+		glDetachShader( ID, tessControlShader.GetID() );
+		glDetachShader( ID, tessEvaluationShader.GetID() );
 		glDetachShader( ID, geometryShader.GetID() );
 		glDetachShader( ID, fragmentShader.GetID() );
 		glDetachShader( ID, computeShader.GetID() );
@@ -103,6 +225,9 @@ void ShaderProgram::Delete( void )
 
 		ID = 0;
 	}
+
+	uniformSlots.clear();
+	uniformCount = 0;
 }
 
 /*=================================================================================================
@@ -111,11 +236,44 @@ void ShaderProgram::Delete( void )
 
 void ShaderProgram::Link( void )
 {
+	linkedFromBinary = false;
+
+	submitLink();
+	finishLink();
+}
+
+void ShaderProgram::submitLink( void )
+{
+	if( BinaryCacheDirectory.empty() == false && GLEW_ARB_get_program_binary )
+		glProgramParameteri( ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
 	glLinkProgram( ID );
+}
+
+// Collects the results of a submitted link; this is where the driver is waited on
+void ShaderProgram::finishLink( void )
+{
+	if( linkedFromBinary == false )
+	{
+		vertexShader.CheckCompileStatus();
+		tessControlShader.CheckCompileStatus();
+		tessEvaluationShader.CheckCompileStatus();
+		geometryShader.CheckCompileStatus();
+		fragmentShader.CheckCompileStatus();
+		computeShader.CheckCompileStatus();
+
+		// If the program didn't link successfully, print log
+		if( GetLinkStatus() == 0 )
+			std::cerr << "shader program " << ID << " link log" << std::endl << GetInfoLog() << std::endl;
+		else
+			saveProgramBinary();
+	}
+
+	// Locations can change on every link, so the lookup table is rebuilt here (this covers Reload too)
+	cacheUniformLocations();
 
-	// If the program didn't link successfully, print log
-	if( GetLinkStatus() == 0 )
-		std::cerr << "shader program " << ID << " link log" << std::endl << GetInfoLog() << std::endl;
+	// Relinking resets block bindings to 0 as well
+	applyUniformBlockBindings();
 }
 
 /*=================================================================================================
@@ -137,13 +295,140 @@ void ShaderProgram::Validate( void )
 
 void ShaderProgram::Reload( void )
 {
-	vertexShader.Load();
-	geometryShader.Load();
-	fragmentShader.Load();
-	computeShader.Load();
+	vertexShader.Compile();
+	tessControlShader.Compile();
+	tessEvaluationShader.Compile();
+	geometryShader.Compile();
+	fragmentShader.Compile();
+	computeShader.Compile();
 	Link();
 }
 
+/*=================================================================================================
+  PROGRAM BINARY CACHE
+=================================================================================================*/
+
+void ShaderProgram::SetBinaryCacheDirectory( std::string directory )
+{
+	BinaryCacheDirectory = directory;
+}
+
+// Cache file for the current stage sources on the current driver, or "" if caching isn't possible
+std::string ShaderProgram::binaryCachePath( void ) const
+{
+	if( ID == 0 || BinaryCacheDirectory.empty() == true || !GLEW_ARB_get_program_binary )
+		return "";
+
+	GLint numFormats = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+	if( numFormats <= 0 )
+		return "";
+
+	// 64-bit FNV-1a over the driver strings and every stage's source
+	unsigned long long hash = 14695981039346656037ull;
+	auto hashBytes = [&hash]( const char* data, size_t length ) {
+		for( size_t i = 0; i < length; i++ )
+		{
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+		hash ^= 0xff; // separator, so "ab"+"c" and "a"+"bc" differ
+		hash *= 1099511628211ull;
+	};
+
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for( GLenum name : driverStrings )
+	{
+		const char* str = (const char*)glGetString( name );
+		if( str != NULL )
+			hashBytes( str, strlen( str ) );
+	}
+
+	const Shader* stages[] = { &vertexShader, &tessControlShader, &tessEvaluationShader, &geometryShader, &fragmentShader, &computeShader };
+	for( const Shader* stage : stages )
+	{
+		if( stage->GetID() == 0 )
+			continue;
+
+		std::string source;
+		if( stage->ReadSource( source ) == false )
+			return "";
+
+		GLenum type = stage->GetType();
+		hashBytes( (const char*)&type, sizeof( type ) );
+		hashBytes( source.data(), source.size() );
+	}
+
+	char name[32];
+	snprintf( name, sizeof( name ), "%016llx.bin", hash );
+
+	return BinaryCacheDirectory + "/" + name;
+}
+
+bool ShaderProgram::loadProgramBinary( void )
+{
+	std::string path = binaryCachePath();
+	if( path.empty() == true )
+		return false;
+
+	std::ifstream file( path, std::ios::binary | std::ios::ate );
+	if( file.is_open() == false )
+		return false;
+
+	std::streamoff fileSize = file.tellg();
+	file.seekg( 0 );
+
+	GLenum format = 0;
+	GLint length = 0;
+	file.read( (char*)&format, sizeof( format ) );
+	file.read( (char*)&length, sizeof( length ) );
+	if( !file || length <= 0 || length != fileSize - (std::streamoff)( sizeof( format ) + sizeof( length ) ) )
+		return false;
+
+	std::vector<char> binary( length );
+	file.read( binary.data(), length );
+	if( !file )
+		return false;
+
+	glProgramBinary( ID, format, binary.data(), length );
+
+	// The driver rejects binaries from other builds or hardware; fall back to compiling
+	return GetLinkStatus() == 1;
+}
+
+void ShaderProgram::saveProgramBinary( void )
+{
+	if( GetLinkStatus() != 1 )
+		return;
+
+	std::string path = binaryCachePath();
+	if( path.empty() == true )
+		return;
+
+	GLint length = 0;
+	glGetProgramiv( ID, GL_PROGRAM_BINARY_LENGTH, &length );
+	if( length <= 0 )
+		return;
+
+	std::vector<char> binary( length );
+	GLenum format = 0;
+	glGetProgramBinary( ID, length, &length, &format, binary.data() );
+
+#ifdef _WIN32
+	_mkdir( BinaryCacheDirectory.c_str() );
+#else
+	mkdir( BinaryCacheDirectory.c_str(), 0755 );
+#endif
+
+	std::ofstream file( path, std::ios::binary );
+	if( file.is_open() == false )
+		return;
+
+	file.write( (const char*)&format, sizeof( format ) );
+	file.write( (const char*)&length, sizeof( length ) );
+	file.write( binary.data(), length );
+}
+
 /*=================================================================================================
   USE
 =================================================================================================*/
@@ -250,6 +535,156 @@ std::string ShaderProgram::GetInfoLog( void ) const
 	return stringLog;
 }
 
+/*=================================================================================================
+  UNIFORM LOCATIONS
+=================================================================================================*/
+
+// FNV-1a, computed straight from the C string so lookups never allocate
+GLuint ShaderProgram::hashUniformName( const GLchar* name )
+{
+	GLuint hash = 2166136261u;
+	for( const GLchar* c = name; *c != '\0'; c++ )
+	{
+		hash ^= (unsigned char)*c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void ShaderProgram::insertUniformLocation( const std::string& name, GLuint hash, GLint location ) const
+{
+	// Keep the load factor at or below one half so probe sequences stay short
+	if( ( uniformCount + 1 ) * 2 > uniformSlots.size() )
+	{
+		std::vector<UniformSlot> oldSlots;
+		oldSlots.swap( uniformSlots );
+
+		size_t capacity = oldSlots.empty() ? 16 : oldSlots.size() * 2;
+		uniformSlots.resize( capacity );
+		uniformCount = 0;
+
+		for( size_t i = 0; i < oldSlots.size(); i++ )
+			if( oldSlots[i].name.empty() == false )
+				insertUniformLocation( oldSlots[i].name, oldSlots[i].hash, oldSlots[i].location );
+	}
+
+	GLuint mask = (GLuint)uniformSlots.size() - 1;
+	GLuint i = hash & mask;
+	while( uniformSlots[i].name.empty() == false )
+	{
+		if( uniformSlots[i].hash == hash && uniformSlots[i].name == name )
+		{
+			uniformSlots[i].location = location;
+			return;
+		}
+		i = ( i + 1 ) & mask;
+	}
+
+	uniformSlots[i].name = name;
+	uniformSlots[i].hash = hash;
+	uniformSlots[i].location = location;
+	uniformCount++;
+}
+
+void ShaderProgram::cacheUniformLocations( void )
+{
+	uniformSlots.clear();
+	uniformCount = 0;
+
+	if( GetLinkStatus() != 1 )
+		return;
+
+	int numUniforms = GetNumActiveUniforms();
+	int maxLength = GetActiveUniformMaxLength();
+	if( numUniforms <= 0 || maxLength <= 0 )
+		return;
+
+	std::vector<GLchar> nameBuffer( maxLength );
+
+	for( int i = 0; i < numUniforms; i++ )
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform( ID, (GLuint)i, (GLsizei)maxLength, &length, &size, &type, nameBuffer.data() );
+
+		std::string name( nameBuffer.data(), length );
+		GLint location = glGetUniformLocation( ID, name.c_str() );
+
+		// Members of uniform blocks have no location
+		if( location < 0 )
+			continue;
+
+		insertUniformLocation( name, hashUniformName( name.c_str() ), location );
+
+		// Arrays are reported as "name[0]", but are usually set through the bare name
+		if( name.size() > 3 && name.compare( name.size() - 3, 3, "[0]" ) == 0 )
+		{
+			std::string baseName = name.substr( 0, name.size() - 3 );
+			insertUniformLocation( baseName, hashUniformName( baseName.c_str() ), location );
+		}
+	}
+}
+
+GLint ShaderProgram::getUniformLocation( const GLchar* name ) const
+{
+	if( ID == 0 )
+		return -1;
+
+	GLuint hash = hashUniformName( name );
+
+	if( uniformSlots.empty() == false )
+	{
+		GLuint mask = (GLuint)uniformSlots.size() - 1;
+		for( GLuint i = hash & mask; uniformSlots[i].name.empty() == false; i = ( i + 1 ) & mask )
+		{
+			if( uniformSlots[i].hash == hash && uniformSlots[i].name == name )
+				return uniformSlots[i].location;
+		}
+	}
+
+	// Unknown name: ask the driver once and remember the answer, even if it is -1
+	GLint location = glGetUniformLocation( ID, name );
+	insertUniformLocation( name, hash, location );
+
+	return location;
+}
+
+/*=================================================================================================
+  UNIFORM BLOCKS
+=================================================================================================*/
+
+void ShaderProgram::SetUniformBlockBinding( const GLchar* name, GLuint binding )
+{
+	bool found = false;
+	for( size_t i = 0; i < blockBindings.size(); i++ )
+	{
+		if( blockBindings[i].name == name )
+		{
+			blockBindings[i].binding = binding;
+			found = true;
+		}
+	}
+
+	if( found == false )
+		blockBindings.push_back( { name, binding } );
+
+	applyUniformBlockBindings();
+}
+
+void ShaderProgram::applyUniformBlockBindings( void )
+{
+	if( GetLinkStatus() != 1 )
+		return;
+
+	for( size_t i = 0; i < blockBindings.size(); i++ )
+	{
+		GLuint index = glGetUniformBlockIndex( ID, blockBindings[i].name.c_str() );
+		if( index != GL_INVALID_INDEX )
+			glUniformBlockBinding( ID, index, blockBindings[i].binding );
+	}
+}
+
 /*=================================================================================================
   UNIFORM SETTERS
 =================================================================================================*/
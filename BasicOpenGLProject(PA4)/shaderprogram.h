@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 #include <string>
+#include <vector>
 #include "shader.h"
 
 class ShaderProgram
@@ -12,18 +13,43 @@ public:
 	ShaderProgram( std::string cspath );
 	ShaderProgram( std::string vspath, std::string fspath );
 	ShaderProgram( std::string vspath, std::string gspath, std::string fspath );
+	ShaderProgram( std::string vspath, std::string tcspath, std::string tespath, std::string fspath );
 	~ShaderProgram();
 
 public:
 	void Create( std::string cspath );
 	void Create( std::string vspath, std::string fspath );
 	void Create( std::string vspath, std::string gspath, std::string fspath );
+
+	/**
+	Builds a program with tessellation stages; it is drawn with GL_PATCHES (see glPatchParameteri).
+	*@param tcspath Path of the tessellation control shader.
+	*@param tespath Path of the tessellation evaluation shader.
+	**/
+	void Create( std::string vspath, std::string tcspath, std::string tespath, std::string fspath );
 	void Delete();
 	void Link();
 	void Validate();
 	void Reload();
 	void Use();
 
+	/**
+	Sets where linked program binaries are cached between runs. Programs whose stage sources and
+	driver (vendor/renderer/version) match a cached binary skip compilation entirely.
+	*@param directory Cache directory; an empty string disables the cache.
+	**/
+	static void SetBinaryCacheDirectory( std::string directory );
+
+	//@{
+	/**
+	Programs created between BeginBatch() and EndBatch() are only submitted to the driver; compile
+	and link results are collected in EndBatch(). With GL_KHR_parallel_shader_compile the driver
+	compiles them on its own threads in the meantime. Programs must stay alive until EndBatch().
+	**/
+	static void BeginBatch();
+	static void EndBatch();
+	//@}
+
 public:
 	int GetStatus( GLenum ) const;
 	int GetDeleteStatus() const;
@@ -42,10 +68,22 @@ public:
 	GLuint GetID() { return ID; }
 
 public:
-	GLint getUniformLocation( const GLchar* name ) const
-	{
-		return glGetUniformLocation( ID, name );
-	}
+	/**
+	Looks up a uniform location by name. Active uniforms are read once after every successful
+	link, so this is served from a table instead of a glGetUniformLocation round-trip.
+	Names the table doesn't know (array elements, inactive uniforms) are asked for once and remembered.
+	*@param name Name of uniform variable.
+	**/
+	GLint getUniformLocation( const GLchar* name ) const;
+
+	/**
+	Connects a uniform block to a uniform buffer binding point (see UniformBuffer). GLSL 4.00 has no
+	layout(binding) qualifier, so this is done from here; the binding is reapplied after every link.
+	Does nothing if the program has no active block of that name.
+	*@param name Name of the uniform block.
+	*@param binding Uniform buffer binding point.
+	**/
+	void SetUniformBlockBinding( const GLchar* name, GLuint binding );
 
 	//@{
 	/**
@@ -123,7 +161,47 @@ public:
 	void SetUniform( GLint location, const GLfloat* m, GLuint dim, GLboolean transpose = GL_FALSE, GLsizei count = 1 );
 	//@}
 
+private:
+	struct UniformSlot
+	{
+		std::string name;
+		GLuint      hash;
+		GLint       location;
+	};
+
+	struct BlockBinding
+	{
+		std::string name;
+		GLuint      binding;
+	};
+
+	void build();
+	void submitLink();
+	void finishLink();
+	bool loadProgramBinary();
+	void saveProgramBinary();
+	std::string binaryCachePath() const;
+
+	void cacheUniformLocations();
+	void applyUniformBlockBindings();
+	void insertUniformLocation( const std::string& name, GLuint hash, GLint location ) const;
+	static GLuint hashUniformName( const GLchar* name );
+
 private:
 	GLuint ID;
-	Shader vertexShader, geometryShader, fragmentShader, computeShader;
+	Shader vertexShader, tessControlShader, tessEvaluationShader, geometryShader, fragmentShader, computeShader;
+
+	// Open-addressed name -> location table (power-of-two size, linear probing)
+	mutable std::vector<UniformSlot> uniformSlots;
+	mutable GLuint uniformCount;
+
+	// Uniform block bindings, kept so they survive Reload and programs loaded from the binary cache
+	std::vector<BlockBinding> blockBindings;
+
+	// Set while the linked program came from the binary cache, so it isn't written back
+	bool linkedFromBinary;
+
+	static std::string BinaryCacheDirectory;
+	static bool Batching;
+	static std::vector<ShaderProgram*> PendingPrograms;
 };
@@ -0,0 +1,10 @@
+#version 400
+
+layout(location=0) in vec4 in_Position;
+out vec4 vert_Position;
+
+// Control points go to the tessellation stages untransformed; the curve is evaluated first
+void main(void)
+{
+	vert_Position = in_Position;
+}
@@ -0,0 +1,19 @@
+#version 400
+
+layout(location=0) in vec4 in_Position;
+layout(location=1) in vec4 in_Color;
+out vec4 vert_Color;
+
+// Filled once per frame by the application and shared by every program
+layout(std140) uniform Camera
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	mat4 modelMatrix;
+};
+
+void main(void)
+{
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4( in_Position.xyz, 1.0 );
+	vert_Color = in_Color;
+}
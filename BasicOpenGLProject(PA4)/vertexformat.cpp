@@ -0,0 +1,274 @@
+#include "vertexformat.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+VertexFormat::VertexFormat()
+{
+	Stride = 0;
+}
+
+/*=================================================================================================
+  ATTRIBUTES
+=================================================================================================*/
+
+VertexFormat& VertexFormat::Add( VertexSemantic semantic, GLuint location, GLint size, GLenum type, GLboolean normalized )
+{
+	// An attribute Pack can't fill would leave garbage in (or overrun) its slot, so it is never added
+	if( IsSupported( type, size ) == false )
+	{
+		std::cerr << "vertex attribute " << location << ": no packing for type 0x" << std::hex << type << std::dec
+			<< " with " << size << " components" << std::endl;
+		assert( false && "unsupported vertex attribute type" );
+		return *this;
+	}
+
+	// A normal in an integer type only keeps its sign and scale as a signed normalized value; the
+	// octahedral encoding is two of them, which the shader unfolds
+	bool integer = ( type != GL_FLOAT && type != GL_HALF_FLOAT );
+	bool signedNormalized = ( type == GL_BYTE || type == GL_SHORT || type == GL_INT_2_10_10_10_REV ) && normalized == GL_TRUE;
+
+	bool fitsSemantic = true;
+	if( semantic == VERTEX_OCTAHEDRAL_NORMAL )
+		fitsSemantic = ( signedNormalized == true && size == 2 );
+	else if( semantic == VERTEX_NORMAL && integer == true )
+		fitsSemantic = signedNormalized;
+
+	if( fitsSemantic == false )
+	{
+		std::cerr << "vertex attribute " << location << ": normals need a normalized signed type"
+			<< ( semantic == VERTEX_OCTAHEDRAL_NORMAL ? " with 2 components" : "" ) << std::endl;
+		assert( false && "normal attribute not signed normalized" );
+		return *this;
+	}
+
+	VertexAttribute attribute;
+	attribute.Semantic = semantic;
+	attribute.Location = location;
+	attribute.Size = size;
+	attribute.Type = type;
+	attribute.Normalized = normalized;
+	attribute.Offset = Stride;
+
+	Attributes.push_back( attribute );
+
+	// Keep every attribute on a 4-byte boundary, some drivers fetch misaligned ones slowly
+	Stride += ( GetTypeSize( type, size ) + 3 ) & ~3;
+	return *this;
+}
+
+void VertexFormat::Clear( void )
+{
+	Attributes.clear();
+	Stride = 0;
+}
+
+GLsizei VertexFormat::GetTypeSize( GLenum type, GLint size )
+{
+	switch( type )
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return size;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return 2 * size;
+		case GL_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+			return 4;
+		default:
+			return 4 * size;
+	}
+}
+
+bool VertexFormat::IsSupported( GLenum type, GLint size )
+{
+	switch( type )
+	{
+		case GL_FLOAT:
+		case GL_HALF_FLOAT:
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+		case GL_SHORT:
+			return size >= 1 && size <= 4;
+		case GL_INT_2_10_10_10_REV:
+			return size == 4;
+		default:
+			return false;
+	}
+}
+
+/*=================================================================================================
+  PACKING
+=================================================================================================*/
+
+static float clampf( float v, float lo, float hi )
+{
+	return v < lo ? lo : ( v > hi ? hi : v );
+}
+
+// IEEE half precision, rounded to nearest; overflow saturates to infinity, tiny values flush to zero
+static GLushort packHalf( float value )
+{
+	GLuint bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+
+	GLuint sign = ( bits >> 16 ) & 0x8000;
+	GLint exponent = (GLint)( ( bits >> 23 ) & 0xFF ) - 127 + 15;
+	GLuint mantissa = bits & 0x7FFFFF;
+
+	if( ( ( bits >> 23 ) & 0xFF ) == 0xFF )
+		return (GLushort)( sign | 0x7C00 | ( mantissa != 0 ? 0x200 : 0 ) );
+	if( exponent <= 0 )
+		return (GLushort)sign;
+
+	// Round the 23-bit mantissa to 10 bits; a carry correctly bumps the exponent
+	GLuint half = ( (GLuint)exponent << 10 ) | ( mantissa >> 13 );
+	if( ( mantissa & 0x1FFF ) > 0x1000 || ( ( mantissa & 0x1FFF ) == 0x1000 && ( half & 1 ) != 0 ) )
+		half++;
+
+	if( half >= 0x7C00 )
+		return (GLushort)( sign | 0x7C00 );
+
+	return (GLushort)( sign | half );
+}
+
+// Folds a unit vector onto the octahedron |x| + |y| + |z| = 1 and unwraps it into the [-1, 1] square
+static void encodeOctahedral( const float* n, float* out )
+{
+	float sum = fabsf( n[0] ) + fabsf( n[1] ) + fabsf( n[2] );
+	if( sum == 0.0f )
+	{
+		out[0] = out[1] = 0.0f;
+		return;
+	}
+
+	float x = n[0] / sum;
+	float y = n[1] / sum;
+
+	if( n[2] < 0.0f )
+	{
+		float fx = ( 1.0f - fabsf( y ) ) * ( x >= 0.0f ? 1.0f : -1.0f );
+		float fy = ( 1.0f - fabsf( x ) ) * ( y >= 0.0f ? 1.0f : -1.0f );
+		x = fx;
+		y = fy;
+	}
+
+	out[0] = x;
+	out[1] = y;
+}
+
+// Rounds v to an integer in [lo, hi]. Normalized, v is first mapped from [-1, 1] onto [-hi, hi],
+// or from [0, 1] onto [0, hi] for an unsigned type (lo = 0)
+static float quantize( float v, GLboolean normalized, float lo, float hi )
+{
+	if( normalized == GL_TRUE )
+		v = clampf( v, lo < 0.0f ? -1.0f : 0.0f, 1.0f ) * hi;
+
+	return floorf( clampf( v, lo, hi ) + 0.5f );
+}
+
+// Signed 10:10:10:2, x in the lowest bits
+static GLuint pack2101010( const float* v, GLboolean normalized )
+{
+	GLint x = (GLint)quantize( v[0], normalized, -512.0f, 511.0f );
+	GLint y = (GLint)quantize( v[1], normalized, -512.0f, 511.0f );
+	GLint z = (GLint)quantize( v[2], normalized, -512.0f, 511.0f );
+	GLint w = (GLint)quantize( v[3], normalized, -2.0f, 1.0f );
+
+	return ( (GLuint)x & 0x3FF ) | ( ( (GLuint)y & 0x3FF ) << 10 ) | ( ( (GLuint)z & 0x3FF ) << 20 ) | ( ( (GLuint)w & 0x3 ) << 30 );
+}
+
+void VertexFormat::Pack( const float* positions, const float* colors, const float* normals, GLsizei count, std::vector<unsigned char>& out ) const
+{
+	out.resize( (size_t)count * Stride );
+
+	for( size_t a = 0; a < Attributes.size(); a++ )
+	{
+		const VertexAttribute& attribute = Attributes[ a ];
+
+		const float* source = positions;
+		if( attribute.Semantic == VERTEX_COLOR )
+			source = colors;
+		else if( attribute.Semantic == VERTEX_NORMAL || attribute.Semantic == VERTEX_OCTAHEDRAL_NORMAL )
+			source = normals;
+
+		bool octahedral = attribute.Semantic == VERTEX_OCTAHEDRAL_NORMAL;
+		bool unitLength = attribute.Semantic == VERTEX_NORMAL && attribute.Normalized == GL_TRUE;
+
+		unsigned char* dst = out.data() + attribute.Offset;
+
+		for( GLsizei i = 0; i < count; i++, dst += Stride )
+		{
+			float v[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			if( source != NULL )
+				memcpy( v, source + 4 * i, sizeof( v ) );
+
+			if( unitLength == true )
+			{
+				float length = sqrtf( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+				if( length > 0.0f )
+				{
+					v[0] /= length;
+					v[1] /= length;
+					v[2] /= length;
+				}
+			}
+
+			if( octahedral == true )
+				encodeOctahedral( v, v );
+
+			switch( attribute.Type )
+			{
+				case GL_HALF_FLOAT:
+				{
+					for( GLint c = 0; c < attribute.Size; c++ )
+					{
+						GLushort half = packHalf( v[ c ] );
+						memcpy( dst + 2 * c, &half, sizeof( half ) );
+					}
+					break;
+				}
+				case GL_SHORT:
+				{
+					for( GLint c = 0; c < attribute.Size; c++ )
+					{
+						GLshort value = (GLshort)quantize( v[ c ], attribute.Normalized, -32768.0f, 32767.0f );
+						memcpy( dst + 2 * c, &value, sizeof( value ) );
+					}
+					break;
+				}
+				case GL_BYTE:
+				{
+					for( GLint c = 0; c < attribute.Size; c++ )
+						dst[ c ] = (unsigned char)(signed char)quantize( v[ c ], attribute.Normalized, -128.0f, 127.0f );
+					break;
+				}
+				case GL_INT_2_10_10_10_REV:
+				{
+					GLuint packed = pack2101010( v, attribute.Normalized );
+					memcpy( dst, &packed, sizeof( packed ) );
+					break;
+				}
+				case GL_UNSIGNED_BYTE:
+				{
+					for( GLint c = 0; c < attribute.Size; c++ )
+						dst[ c ] = (unsigned char)quantize( v[ c ], attribute.Normalized, 0.0f, 255.0f );
+					break;
+				}
+				case GL_FLOAT:
+				{
+					memcpy( dst, v, attribute.Size * sizeof( float ) );
+					break;
+				}
+			}
+		}
+	}
+}
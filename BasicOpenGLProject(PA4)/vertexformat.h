@@ -0,0 +1,70 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+// Which per-vertex stream an attribute is packed from
+enum VertexSemantic
+{
+	VERTEX_POSITION,
+	VERTEX_COLOR,
+	VERTEX_NORMAL,           // float, half, or a normalized signed integer type
+	VERTEX_OCTAHEDRAL_NORMAL // the normal folded onto an octahedron: 2 normalized GL_BYTE or GL_SHORT, decoded in the shader
+};
+
+struct VertexAttribute
+{
+	VertexSemantic Semantic;
+	GLuint Location;
+	GLint Size;
+	GLenum Type;
+	GLboolean Normalized;
+	GLuint Offset;
+};
+
+/**
+Describes the layout of one interleaved vertex buffer: which attributes it holds, in which GL
+types, and where each sits inside a vertex. MeshBuffer::SetFormat points a VAO at it, and Pack
+converts the float4 streams the generators produce into it.
+**/
+class VertexFormat
+{
+public:
+	VertexFormat();
+
+public:
+	/**
+	Appends an attribute after the previous one (offsets are kept 4-byte aligned). Pack can only fill
+	the types below, and normals only fit integer types that are signed and normalized (see
+	VertexSemantic); anything else is reported, asserted on and left out of the format.
+	*@param semantic Stream the attribute is packed from.
+	*@param location Attribute location in the vertex shader.
+	*@param size Number of components, 1 to 4; exactly 4 for GL_INT_2_10_10_10_REV.
+	*@param type GL_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_BYTE, GL_BYTE, GL_SHORT or GL_INT_2_10_10_10_REV.
+	*@param normalized Whether integer values are mapped to [0, 1] / [-1, 1]; otherwise Pack rounds
+	*                  the float values to the nearest integer of the type.
+	**/
+	VertexFormat& Add( VertexSemantic semantic, GLuint location, GLint size, GLenum type, GLboolean normalized = GL_FALSE );
+	void Clear();
+
+	/**
+	Packs count vertices into out, resized to count * stride bytes. Every source holds 4 floats per
+	vertex; a NULL source packs zeros. Normals stored in normalized integer types are made unit length first.
+	**/
+	void Pack( const float* positions, const float* colors, const float* normals, GLsizei count, std::vector<unsigned char>& out ) const;
+
+public:
+	GLsizei GetStride() const { return Stride; }
+	const std::vector<VertexAttribute>& GetAttributes() const { return Attributes; }
+
+	static GLsizei GetTypeSize( GLenum type, GLint size );
+
+	/**
+	Whether Pack can convert size components to type.
+	**/
+	static bool IsSupported( GLenum type, GLint size );
+
+private:
+	std::vector<VertexAttribute> Attributes;
+	GLsizei Stride;
+};
@@ -0,0 +1,519 @@
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "torus.h"
+#include "curve.h"
+#include "meshbuffer.h"
+#include "torustessellator.h"
+#include "vertexformat.h"
+#include "headless.h"
+
+// Benchmarks the mesh generators and buffer uploads of the viewers over a sweep of tessellation
+// levels. Every case runs once to warm up, then until it has both enough repetitions and enough
+// time; the median call is reported. Usage:
+//   Benchmark [--csv FILE] [--json FILE] [--min-time MS] [--repetitions N] [--threads N] [--no-gl]
+
+/*=================================================================================================
+	ALLOCATIONS
+=================================================================================================*/
+
+// Every operator new in the process passes through here, so the counts per case are exact
+static std::atomic<long long> AllocationCount( 0 );
+static std::atomic<long long> AllocationBytes( 0 );
+
+void* operator new( size_t size )
+{
+	AllocationCount++;
+	AllocationBytes += (long long)size;
+
+	void* memory = malloc( size > 0 ? size : 1 );
+	if( memory == NULL )
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+void operator delete( void* memory ) noexcept { free( memory ); }
+void operator delete[]( void* memory ) noexcept { free( memory ); }
+void operator delete( void* memory, size_t ) noexcept { free( memory ); }
+void operator delete[]( void* memory, size_t ) noexcept { free( memory ); }
+
+/*=================================================================================================
+	SETTINGS
+=================================================================================================*/
+
+struct Settings
+{
+	int MinRepetitions = 5;
+	int MaxRepetitions = 100000;
+	double MinTime = 100.0; // milliseconds per case
+	int Threads = 1;        // TorusMesh workers; 1 keeps runs comparable across machines
+	bool UseGL = true;
+	std::string CsvFile;
+	std::string JsonFile;
+};
+
+Settings settings;
+
+// Slices and loops of the torus cases, samples of the curve cases
+const int TorusLevels[] = { 8, 16, 32, 64, 128, 256, 512, 1024 };
+const int CurveLevels[] = { 8, 32, 128, 512, 2048, 8192 };
+
+// The viewers' defaults: PA3's torus and PA4's control polygon
+const float TorusRadius = 0.4f;
+const float TubeRadius = 0.2f;
+
+const float ControlPoints[] = {
+	-1.0f, 0.0f, 0.0f, 0.0f,
+	-0.25f, 1.0f, 0.0f, 0.0f,
+	0.25f, 1.0f, 0.0f, 0.0f,
+	1.0f, 0.0f, 0.0f, 0.0f,
+	0.25f, -1.0f, 0.0f, 0.0f,
+	-0.25f, -1.0f, 0.0f, 0.0f,
+};
+
+// Control points of the bezier_degree_127 case, along a spiral
+const int HighDegreePoints = 128;
+
+// Flatness tolerances of the adaptive curve cases: 1/level of a pixel of PA4's window (800 pixels high,
+// 60 degree field of view, curve 2 units from the eye) at zoom 1
+const int AdaptiveLevels[] = { 1, 4, 16, 64 };
+const float PixelSize = 2.0f * 2.0f * 0.57735027f / 800.0f;
+
+// Uniform knots for the quadratic B-spline of the six control points
+const std::vector<float> Knots = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+
+/*=================================================================================================
+	MEASUREMENT
+=================================================================================================*/
+
+typedef std::chrono::steady_clock Clock;
+
+// What one call of a case produced
+struct Output
+{
+	long long Vertices;
+	long long UploadedBytes;
+};
+
+struct Result
+{
+	std::string Case;
+	int Level;
+	long long Vertices;      // per call
+	int Repetitions;
+	double MedianNs;         // per call
+	double MinNs;
+	double NsPerVertex;      // median call / vertices
+	double Allocations;      // per call, after the warm-up call
+	double AllocatedBytes;
+	long long UploadedBytes; // per call
+};
+
+std::vector<Result> results;
+
+template<typename Work>
+void measure( const char* name, int level, Work work )
+{
+	// The warm-up call grows every buffer to its final size, so the timed calls show the steady state
+	Output output = work();
+
+	std::vector<double> times;
+	long long allocations = 0;
+	long long allocatedBytes = 0;
+
+	Clock::time_point start = Clock::now();
+	double elapsed = 0.0;
+
+	do
+	{
+		// Counted around the call only, times growing is not the case's doing
+		long long count = AllocationCount;
+		long long bytes = AllocationBytes;
+
+		Clock::time_point begin = Clock::now();
+		output = work();
+		Clock::time_point end = Clock::now();
+
+		allocations += AllocationCount - count;
+		allocatedBytes += AllocationBytes - bytes;
+
+		times.push_back( std::chrono::duration<double, std::nano>( end - begin ).count() );
+		elapsed = std::chrono::duration<double, std::milli>( end - start ).count();
+	}
+	while( ( (int)times.size() < settings.MinRepetitions || elapsed < settings.MinTime ) && (int)times.size() < settings.MaxRepetitions );
+
+	double repetitions = (double)times.size();
+	std::sort( times.begin(), times.end() );
+
+	Result result;
+	result.Case = name;
+	result.Level = level;
+	result.Vertices = output.Vertices;
+	result.Repetitions = (int)times.size();
+	result.MedianNs = times[times.size() / 2];
+	result.MinNs = times.front();
+	result.NsPerVertex = output.Vertices > 0 ? result.MedianNs / output.Vertices : 0.0;
+	result.Allocations = allocations / repetitions;
+	result.AllocatedBytes = allocatedBytes / repetitions;
+	result.UploadedBytes = output.UploadedBytes;
+
+	printf( "  %-24s %6d %10lld %12.0f %10.2f %10.1f %12.0f %12lld\n", name, level, result.Vertices, result.MedianNs,
+		result.NsPerVertex, result.Allocations, result.AllocatedBytes, result.UploadedBytes );
+
+	results.push_back( result );
+}
+
+/*=================================================================================================
+	CASES
+=================================================================================================*/
+
+void benchmarkTorus( int level )
+{
+	TorusMesh mesh;
+	mesh.SetThreadCount( settings.Threads );
+	mesh.SetColor( 1.0f, 0.5f, 0.0f, 1.0f );
+
+	// Same call as PA3's generateTorusAt, once per normal mode
+	mesh.SetNormalMode( TORUS_NORMALS_VERTEX );
+	measure( "torus_vertex_normals", level, [&]() {
+		mesh.Generate( 0.0f, 0.0f, 0.0f, TorusRadius, TubeRadius, level, level );
+		return Output{ mesh.GetVertexCount(), 0 };
+	} );
+
+	mesh.SetNormalMode( TORUS_NORMALS_FACE );
+	measure( "torus_face_normals", level, [&]() {
+		mesh.Generate( 0.0f, 0.0f, 0.0f, TorusRadius, TubeRadius, level, level );
+		return Output{ mesh.GetVertexCount(), 0 };
+	} );
+
+	if( settings.UseGL == false )
+		return;
+
+	// The three layouts of PA3's CreateTorusBuffers; glFinish so the driver's copy is part of the time
+	MeshBuffer buffer;
+	buffer.Create( 3 );
+
+	measure( "upload_float_streams", level, [&]() {
+		GLsizeiptr size = sizeof( float ) * mesh.GetVertices().size();
+		buffer.SetData( 0, mesh.GetVertices().data(), size );
+		buffer.SetData( 1, mesh.GetColors().data(), size );
+		buffer.SetData( 2, mesh.GetNormals().data(), size );
+		buffer.SetIndexData( mesh.GetIndexData(), mesh.GetIndexDataSize() );
+		glFinish();
+		return Output{ mesh.GetVertexCount(), 3 * size + mesh.GetIndexDataSize() };
+	} );
+
+	VertexFormat packedFormat;
+	packedFormat.Add( VERTEX_POSITION, 0, 3, GL_FLOAT );
+	packedFormat.Add( VERTEX_NORMAL, 2, 4, GL_INT_2_10_10_10_REV, GL_TRUE );
+	packedFormat.Add( VERTEX_COLOR, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE );
+
+	VertexFormat compressedFormat;
+	compressedFormat.Add( VERTEX_POSITION, 0, 4, GL_HALF_FLOAT );
+	compressedFormat.Add( VERTEX_OCTAHEDRAL_NORMAL, 2, 2, GL_SHORT, GL_TRUE );
+	compressedFormat.Add( VERTEX_COLOR, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE );
+
+	std::vector<unsigned char> packed;
+
+	// Packing happens on every edit in the viewer, so it is timed together with the upload
+	const VertexFormat* formats[] = { &packedFormat, &compressedFormat };
+	const char* names[] = { "upload_packed", "upload_compressed" };
+
+	for( int f = 0; f < 2; f++ )
+	{
+		measure( names[f], level, [&]() {
+			formats[f]->Pack( mesh.GetVertices().data(), mesh.GetColors().data(), mesh.GetNormals().data(), mesh.GetVertexCount(), packed );
+			buffer.SetData( 0, packed.data(), packed.size() );
+			buffer.SetIndexData( mesh.GetIndexData(), mesh.GetIndexDataSize() );
+			glFinish();
+			return Output{ mesh.GetVertexCount(), (long long)packed.size() + mesh.GetIndexDataSize() };
+		} );
+	}
+
+	// PA3's compute tessellator: generation and storage in one step, nothing is uploaded
+	TorusTessellator tessellator;
+	if( tessellator.Create( "../BasicOpenGLProject(PA3)/shaders/torus.comp" ) == false )
+		return;
+
+	tessellator.SetColor( 1.0f, 0.5f, 0.0f, 1.0f );
+	tessellator.SetNormalMode( TORUS_NORMALS_FACE );
+
+	measure( "torus_compute", level, [&]() {
+		tessellator.Generate( buffer, 0.0f, 0.0f, 0.0f, TorusRadius, TubeRadius, level, level );
+		glFinish();
+		return Output{ tessellator.GetVertexCount(), 0 };
+	} );
+}
+
+void buildSpiral( std::vector<float>& points )
+{
+	for( int i = 0; i < HighDegreePoints; i++ )
+	{
+		float angle = 0.25f * i;
+		float radius = (float)i / HighDegreePoints;
+		points.insert( points.end(), { radius * cosf( angle ), radius * sinf( angle ), 0.0f, 0.0f } );
+	}
+}
+
+void benchmarkCurves( int level )
+{
+	Curve curve;
+	curve.SetControlPoints( ControlPoints, 6 );
+	curve.SetKnots( Knots );
+
+	// PA4's createBezier and createBSpline, without their upload
+	measure( "bezier", level, [&]() {
+		curve.SampleBezier( (float)level );
+		return Output{ curve.GetVertexCount(), 0 };
+	} );
+
+	measure( "bspline", level, [&]() {
+		curve.SampleBSpline( (float)level );
+		return Output{ curve.GetVertexCount(), 0 };
+	} );
+
+	// The de Casteljau fallback on the same curve, then a curve of a degree only it handles
+	curve.SetBezierMethod( BEZIER_DE_CASTELJAU );
+	measure( "bezier_de_casteljau", level, [&]() {
+		curve.SampleBezier( (float)level );
+		return Output{ curve.GetVertexCount(), 0 };
+	} );
+	curve.SetBezierMethod( BEZIER_AUTO );
+
+	std::vector<float> spiral;
+	buildSpiral( spiral );
+
+	Curve highDegree;
+	highDegree.SetControlPoints( spiral.data(), HighDegreePoints );
+
+	measure( "bezier_degree_127", level, [&]() {
+		highDegree.SampleBezier( (float)level );
+		return Output{ highDegree.GetVertexCount(), 0 };
+	} );
+
+	// A higher degree B-spline over the same points, on its default uniform knots
+	highDegree.SetDegree( 5 );
+	measure( "bspline_degree_5", level, [&]() {
+		highDegree.SampleBSpline( (float)level );
+		return Output{ highDegree.GetVertexCount(), 0 };
+	} );
+
+	// PA4's 'w'/'a'/'s'/'d' on that B-spline: moving a point only resamples the spans it weighs,
+	// vertices are the samples that changed
+	const int point = HighDegreePoints / 2;
+	int first = 0;
+	int changed = 0;
+
+	measure( "bspline_move_point", level, [&]() {
+		spiral[point * 4 + 1] = -spiral[point * 4 + 1];
+		highDegree.MoveBSplinePoint( point, &spiral[point * 4], first, changed );
+		return Output{ changed, 0 };
+	} );
+
+	if( settings.UseGL == false )
+		return;
+
+	// PA4's CreateCurveBuffers, from the Bezier samples
+	curve.SampleBezier( (float)level );
+
+	MeshBuffer buffer;
+	buffer.Create( 2 );
+
+	measure( "upload_curve", level, [&]() {
+		GLsizeiptr size = sizeof( float ) * curve.GetVertices().size();
+		buffer.SetData( 0, curve.GetVertices().data(), size );
+		buffer.SetData( 1, curve.GetColors().data(), size );
+		glFinish();
+		return Output{ curve.GetVertexCount(), 2 * size };
+	} );
+}
+
+// PA4's adaptive mode ('t'); the vertex counts compare with the uniform cases at the same quality
+void benchmarkAdaptive( int level )
+{
+	const float tolerance = PixelSize / level;
+
+	Curve curve;
+	curve.SetControlPoints( ControlPoints, 6 );
+	curve.SetKnots( Knots );
+
+	measure( "bezier_adaptive", level, [&]() {
+		curve.TessellateBezier( tolerance );
+		return Output{ curve.GetVertexCount(), 0 };
+	} );
+
+	measure( "bspline_adaptive", level, [&]() {
+		curve.TessellateBSpline( tolerance );
+		return Output{ curve.GetVertexCount(), 0 };
+	} );
+
+	std::vector<float> spiral;
+	buildSpiral( spiral );
+
+	Curve highDegree;
+	highDegree.SetControlPoints( spiral.data(), HighDegreePoints );
+
+	measure( "bezier_adaptive_d127", level, [&]() {
+		highDegree.TessellateBezier( tolerance );
+		return Output{ highDegree.GetVertexCount(), 0 };
+	} );
+
+	highDegree.SetDegree( 5 );
+	measure( "bspline_adaptive_d5", level, [&]() {
+		highDegree.TessellateBSpline( tolerance );
+		return Output{ highDegree.GetVertexCount(), 0 };
+	} );
+}
+
+/*=================================================================================================
+	OUTPUT
+=================================================================================================*/
+
+bool writeCSV( const std::string& path )
+{
+	std::ofstream file( path );
+	if( file.is_open() == false )
+		return false;
+
+	file << "case,level,vertices,repetitions,median_ns,min_ns,ns_per_vertex,allocations,allocated_bytes,uploaded_bytes\n";
+
+	for( size_t i = 0; i < results.size(); i++ )
+	{
+		const Result& r = results[i];
+		file << r.Case << "," << r.Level << "," << r.Vertices << "," << r.Repetitions << "," << r.MedianNs << "," << r.MinNs << ","
+			<< r.NsPerVertex << "," << r.Allocations << "," << r.AllocatedBytes << "," << r.UploadedBytes << "\n";
+	}
+
+	return true;
+}
+
+// Escapes the few characters a renderer string could contain that JSON doesn't allow as is
+std::string jsonString( const std::string& text )
+{
+	std::string out = "\"";
+	for( size_t i = 0; i < text.size(); i++ )
+	{
+		if( text[i] == '"' || text[i] == '\\' )
+			out += '\\';
+		if( (unsigned char)text[i] >= 0x20 )
+			out += text[i];
+	}
+
+	return out + "\"";
+}
+
+bool writeJSON( const std::string& path, const std::string& renderer )
+{
+	std::ofstream file( path );
+	if( file.is_open() == false )
+		return false;
+
+	file << "{\n";
+	file << "  \"renderer\": " << jsonString( renderer ) << ",\n";
+	file << "  \"threads\": " << settings.Threads << ",\n";
+	file << "  \"min_repetitions\": " << settings.MinRepetitions << ",\n";
+	file << "  \"min_time_ms\": " << settings.MinTime << ",\n";
+	file << "  \"results\": [\n";
+
+	for( size_t i = 0; i < results.size(); i++ )
+	{
+		const Result& r = results[i];
+		file << "    { \"case\": " << jsonString( r.Case ) << ", \"level\": " << r.Level << ", \"vertices\": " << r.Vertices
+			<< ", \"repetitions\": " << r.Repetitions << ", \"median_ns\": " << r.MedianNs << ", \"min_ns\": " << r.MinNs
+			<< ", \"ns_per_vertex\": " << r.NsPerVertex << ", \"allocations\": " << r.Allocations
+			<< ", \"allocated_bytes\": " << r.AllocatedBytes << ", \"uploaded_bytes\": " << r.UploadedBytes << " }"
+			<< ( i + 1 < results.size() ? ",\n" : "\n" );
+	}
+
+	file << "  ]\n}\n";
+	return true;
+}
+
+/*=================================================================================================
+	MAIN
+=================================================================================================*/
+
+int main( int argc, char** argv )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		bool hasValue = i + 1 < argc;
+
+		if( strcmp( argv[i], "--csv" ) == 0 && hasValue == true )
+			settings.CsvFile = argv[++i];
+		else if( strcmp( argv[i], "--json" ) == 0 && hasValue == true )
+			settings.JsonFile = argv[++i];
+		else if( strcmp( argv[i], "--min-time" ) == 0 && hasValue == true )
+			settings.MinTime = atof( argv[++i] );
+		else if( strcmp( argv[i], "--repetitions" ) == 0 && hasValue == true )
+			settings.MinRepetitions = std::max( 1, atoi( argv[++i] ) );
+		else if( strcmp( argv[i], "--threads" ) == 0 && hasValue == true )
+			settings.Threads = std::max( 0, atoi( argv[++i] ) );
+		else if( strcmp( argv[i], "--no-gl" ) == 0 )
+			settings.UseGL = false;
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--csv FILE] [--json FILE] [--min-time MS] [--repetitions N] [--threads N] [--no-gl]\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	// The upload cases need a context; the same offscreen one the viewers' headless mode uses
+	std::string renderer = "none";
+	HeadlessMode context;
+
+	if( settings.UseGL == true )
+	{
+		if( context.CreateContext( argc, argv ) == false )
+		{
+			std::cerr << "no OpenGL context, run with --no-gl to skip the upload cases\n";
+			return EXIT_FAILURE;
+		}
+
+		renderer = (const char*)glGetString( GL_RENDERER );
+	}
+
+	std::cout << "Renderer: " << renderer << ", torus threads: " << settings.Threads << "\n\n";
+	printf( "  %-24s %6s %10s %12s %10s %10s %12s %12s\n", "case", "level", "vertices", "median ns", "ns/vertex", "allocs", "alloc bytes", "uploaded" );
+
+	for( size_t i = 0; i < sizeof( TorusLevels ) / sizeof( TorusLevels[0] ); i++ )
+		benchmarkTorus( TorusLevels[i] );
+
+	for( size_t i = 0; i < sizeof( CurveLevels ) / sizeof( CurveLevels[0] ); i++ )
+		benchmarkCurves( CurveLevels[i] );
+
+	for( size_t i = 0; i < sizeof( AdaptiveLevels ) / sizeof( AdaptiveLevels[0] ); i++ )
+		benchmarkAdaptive( AdaptiveLevels[i] );
+
+	if( settings.CsvFile.empty() == false && writeCSV( settings.CsvFile ) == false )
+	{
+		std::cerr << "could not write " << settings.CsvFile << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if( settings.JsonFile.empty() == false && writeJSON( settings.JsonFile, renderer ) == false )
+	{
+		std::cerr << "could not write " << settings.JsonFile << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// The orbit camera state the viewers expose to the mouse, at one point in time
+struct CameraKey
+{
+	float Time;
+	float RotationX;
+	float RotationY;
+	float Zoom;
+};
+
+/**
+A scripted camera: keys sorted by time and interpolated linearly in between. Path files hold one
+key per line, "time rotationX rotationY zoom" (degrees for the rotations); '#' starts a comment.
+**/
+class CameraPath
+{
+public:
+	CameraPath();
+
+public:
+	/**
+	Replaces the keys with the ones in a path file.
+	*@return false if the file can't be read, a line is malformed or it holds no keys.
+	**/
+	bool Load( const std::string& path );
+
+	void AddKey( float time, float rotationX, float rotationY, float zoom );
+	void Clear();
+
+	/**
+	Camera at a given time; times outside the path hold the first or last key.
+	**/
+	CameraKey Evaluate( float time ) const;
+
+public:
+	bool IsEmpty() const { return Keys.empty(); }
+	float GetStartTime() const { return Keys.empty() ? 0.0f : Keys.front().Time; }
+	float GetEndTime() const { return Keys.empty() ? 0.0f : Keys.back().Time; }
+
+private:
+	std::vector<CameraKey> Keys;
+};
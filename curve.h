@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+
+// How Curve::SampleBezier evaluates the curve
+enum BezierMethod
+{
+	BEZIER_AUTO,                // forward differences up to MaxForwardDifferenceDegree, de Casteljau above
+	BEZIER_FORWARD_DIFFERENCES, // a few additions per sample, from the power basis of the curve
+	BEZIER_DE_CASTELJAU         // repeated interpolation of the control polygon, stable at any degree
+};
+
+/**
+Samples a curve from the control polygon the viewer edits. Control points and samples are
+xyzw, 4 floats each (w unused), the same layout the point and curve buffers are drawn from.
+Sampling reuses the storage of the previous call.
+**/
+class Curve
+{
+public:
+	Curve();
+
+public:
+	/**
+	Copies the control points.
+	*@param points 4 floats per point.
+	*@param count Number of points.
+	**/
+	void SetControlPoints( const float* points, int count );
+
+	/**
+	Knot vector of the B-spline: count + degree + 1 non-decreasing values. Any other size (an empty
+	vector, say) stands for the uniform knots 0, 1, 2, ...
+	**/
+	void SetKnots( const std::vector<float>& knots );
+
+	/**
+	Degree of the B-spline, 2 (quadratic) by default.
+	**/
+	void SetDegree( int degree );
+
+	void SetColor( float r, float g, float b, float a );
+	void SetBezierMethod( BezierMethod method ) { Method = method; }
+
+	/**
+	Bezier curve of every control point (degree count - 1), sampled at t = 0, 1/steps, ... 1, so it
+	starts and ends on the first and last control point.
+	*@param samples Number of steps over [0, 1], truncated to a whole number of at least 1.
+	**/
+	void SampleBezier( float samples );
+
+	/**
+	Point of the Bezier curve at t, by de Casteljau's algorithm.
+	**/
+	void EvaluateBezier( float t, float& x, float& y );
+
+	/**
+	B-spline of every control point over its whole domain, knots degree to count, where the basis
+	functions sum to 1. Each sample only weighs the degree + 1 control points of its knot span. The
+	spans and basis values depend on the knots and the sample count alone, so they are computed once
+	and reused until either changes; moving control points costs one weighted sum per sample.
+	Needs more control points than the degree.
+	*@param samples Number of steps over the domain, truncated to a whole number of at least 1.
+	**/
+	void SampleBSpline( float samples );
+
+	/**
+	Moves one control point and resamples only the samples of the last SampleBSpline that it weighs:
+	those in the degree + 1 knot spans from its own knot on. The cost depends on the degree and the
+	samples per span, not on the number of control points.
+	Returns false, changing nothing, unless the current samples are SampleBSpline's for the current
+	points, knots and degree; resample the whole curve then.
+	*@param index Control point to move.
+	*@param point Its new position, 4 floats.
+	*@param first Set to the first sample that changed.
+	*@param count Set to the number of samples that changed.
+	**/
+	bool MoveBSplinePoint( int index, const float* point, int& first, int& count );
+
+	//@{
+	/**
+	Adaptive alternatives to SampleBezier and SampleBSpline: segments are halved until every one stays
+	within tolerance of the curve, so flat stretches get few vertices and tight bends many.
+	The Bezier test is exact: the control polygon of a piece (split by de Casteljau) bounds it. The
+	B-spline test checks the curve at the quarter points of each piece, starting from its knot spans.
+	Pieces stop splitting after MaxSubdivisionDepth halvings.
+	*@param tolerance Largest distance between the curve and its line segments, in control point units.
+	**/
+	void TessellateBezier( float tolerance );
+	void TessellateBSpline( float tolerance );
+	//@}
+
+public:
+	const std::vector<float>& GetVertices() const { return Vertices; }
+	const std::vector<float>& GetColors()   const { return Colors;   }
+
+	int GetVertexCount() const { return (int)( Vertices.size() / 4 ); }
+	int GetControlPointCount() const { return (int)( ControlPoints.size() / 4 ); }
+
+	// Above this degree the power basis loses too much precision for forward differencing
+	static const int MaxForwardDifferenceDegree = 12;
+
+	static const int MaxSubdivisionDepth = 16;
+
+private:
+	void clearVertices();
+	void addVertex( float x, float y );
+
+	void sampleBezierForward( int steps );
+	void evaluateBezier( double t, double& x, double& y );
+	void loadControlPoints(); // xy of every control point into Table
+
+	void subdivideBezier( int level, int depth, double tolerance );
+
+	void buildKnots();
+	void buildBasisCache( int steps );
+	int findSpan( double t ) const;
+	void bsplineSample( int k, double& x, double& y ) const;
+	void evaluateBasis( int span, double t, double* basis );
+	void evaluateBSpline( double t, double& x, double& y );
+	void subdivideBSpline( double t0, double t1, double x0, double y0, double x1, double y1, int depth, double tolerance );
+
+private:
+	std::vector<float> ControlPoints; // xyzw per point
+	std::vector<float> Knots;
+
+	std::vector<float> Vertices; // xyzw per sample
+	std::vector<float> Colors;   // rgba per sample
+
+	float Color[4];
+	BezierMethod Method;
+
+	// Working storage of the Bezier evaluators in double precision, xy per entry except Stirling
+	std::vector<double> Table;
+	std::vector<double> Differences;
+	std::vector<double> Stirling;
+	std::vector<double> Subdivision; // one control polygon per subdivision level
+
+	int Degree;
+
+	// Per B-spline sample: its knot span and the Degree + 1 basis values that are nonzero there
+	bool BasisCacheValid;
+	bool BSplineSampled; // Vertices are SampleBSpline's of the current control points and basis cache
+	int BasisCacheSteps;
+	std::vector<double> SplineKnots;
+	std::vector<int> Spans;
+	std::vector<double> BasisCache;
+	std::vector<double> Left;
+	std::vector<double> Right;
+};